@@ -0,0 +1,220 @@
+// Headless bullet-storm benchmark
+// Runs boss phases through BossSystem, BulletSystem and PhysicsSystem only:
+// no window, no rendering and no audio, so it can run on a CI machine.
+//
+// Usage: bullet_benchmark [--boss cirno|flandre|sakuya|remilia|all] [--phase 1-4|all] [--seconds <n>] [--seed <n>]
+// Reports per boss phase:
+//   bullets/s    - bullet updates per second of step time (live bullets summed over frames / total step time)
+//   p50, p99     - step time of BossSystem::step + BulletSystem::step + PhysicsSystem::step, in microseconds
+//   allocs/frame - heap allocations made during those steps, averaged over frames
+#define GL3W_IMPLEMENTATION
+#include <gl3w.h>
+
+// stlib
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+// internal
+#include "physics_system.hpp"
+#include "render_system.hpp"
+#include "bullet_system.hpp"
+#include "boss_system.hpp"
+#include "world_init.hpp"
+#include "components.hpp"
+#include "global.hpp"
+
+// steady clock for interval timing, WorldSystem already defines Clock
+using BenchClock = std::chrono::steady_clock;
+
+// Count every heap allocation, read before and after the measured steps
+static size_t allocation_count = 0;
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	if (void* ptr = malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+// Simulation settings
+const float STEP_MS = 1000.f / 60.f;
+// Boss phase change holds fire for phase_change_time and spawners have an initial cooldown, skip both
+const float WARMUP_MS = 3000.f;
+const int BOSS_PHASE_COUNT = 4;
+// Synthetic boss room in grid cells, walls on the border
+const int BENCH_ROOM_SIZE = 24;
+
+struct BenchBoss {
+	const char* name;
+	BOSS_ID id;
+	MAP_LEVEL level;
+};
+
+const BenchBoss bench_bosses[] = {
+	{ "cirno", BOSS_ID::CIRNO, MAP_LEVEL::LEVEL1 },
+	{ "flandre", BOSS_ID::FLANDRE, MAP_LEVEL::LEVEL2 },
+	{ "sakuya", BOSS_ID::SAKUYA, MAP_LEVEL::LEVEL3 },
+	{ "remilia", BOSS_ID::REMILIA, MAP_LEVEL::LEVEL4 },
+};
+
+struct PhaseResult {
+	int frames = 0;
+	size_t peak_bullets = 0;
+	double bullet_updates = 0;
+	double total_step_us = 0;
+	double p50_us = 0;
+	double p99_us = 0;
+	double allocs_per_frame = 0;
+};
+
+// Square floor room surrounded by walls, bullets leaving the room are removed by the physics system
+void create_synthetic_map()
+{
+	reset_world_default();
+	world_width = BENCH_ROOM_SIZE;
+	world_height = BENCH_ROOM_SIZE;
+	world_center = vec2(BENCH_ROOM_SIZE / 2);
+	world_map = std::vector<std::vector<int>>(world_height, std::vector<int>(world_width, (int)TILE_TYPE::FLOOR));
+	for (int i = 0; i < BENCH_ROOM_SIZE; i++) {
+		world_map[0][i] = (int)TILE_TYPE::WALL;
+		world_map[BENCH_ROOM_SIZE - 1][i] = (int)TILE_TYPE::WALL;
+		world_map[i][0] = (int)TILE_TYPE::WALL;
+		world_map[i][BENCH_ROOM_SIZE - 1] = (int)TILE_TYPE::WALL;
+	}
+}
+
+double percentile(std::vector<double>& sorted_values, float p)
+{
+	if (sorted_values.size() == 0) return 0;
+	size_t index = std::min(sorted_values.size() - 1, (size_t)(p * sorted_values.size()));
+	return sorted_values[index];
+}
+
+PhaseResult run_phase(RenderSystem* renderer, const BenchBoss& bench_boss, int phase, float seconds, unsigned int seed)
+{
+	registry.clear_all_components();
+	rng_service.set_seed(seed);
+	uni_timer = UniversalTimer();
+	focus_mode = FocusMode();
+	map_info.level = bench_boss.level;
+	create_synthetic_map();
+
+	// Bullet phases are chosen by map level at construction
+	BossSystem boss_system;
+	BulletSystem bullets;
+	PhysicsSystem physics;
+	bullets.init(renderer, nullptr, nullptr);
+	physics.init(renderer);
+
+	// Player stands still below the boss, it does not fire so no window or audio is needed
+	createPlayer(renderer, convert_grid_to_world(vec2(BENCH_ROOM_SIZE / 2, BENCH_ROOM_SIZE - 4)));
+	Entity boss_entity = createBoss(renderer, convert_grid_to_world(vec2(BENCH_ROOM_SIZE / 2)), bench_boss.name, bench_boss.id, vec3(1, 0, 0));
+
+	// Put the boss right at the health threshold, the first step moves it into the requested phase
+	Boss& boss = registry.bosses.get(boss_entity);
+	boss.is_active = true;
+	boss.phase_index = phase - 1;
+	registry.hps.get(boss_entity).curr_hp = boss.health_phase_thresholds[phase - 1];
+
+	int total_frames = (int)((WARMUP_MS + seconds * 1000.f) / STEP_MS);
+	int warmup_frames = (int)(WARMUP_MS / STEP_MS);
+	std::vector<double> step_us;
+	step_us.reserve(total_frames);
+
+	PhaseResult result;
+	size_t total_allocations = 0;
+	for (int frame = 0; frame < total_frames; frame++) {
+		size_t allocations_before = allocation_count;
+		auto start = BenchClock::now();
+
+		boss_system.step(STEP_MS);
+		bullets.step(STEP_MS);
+		physics.step(STEP_MS);
+
+		auto end = BenchClock::now();
+		size_t allocations = allocation_count - allocations_before;
+
+		// collisions are normally consumed by WorldSystem::handle_collisions
+		registry.collisions.clear();
+
+		if (frame < warmup_frames) continue;
+		size_t live_bullets = registry.enemyBullets.size() + registry.playerBullets.size();
+		result.peak_bullets = std::max(result.peak_bullets, live_bullets);
+		result.bullet_updates += live_bullets;
+		total_allocations += allocations;
+		step_us.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000.0);
+	}
+
+	result.frames = step_us.size();
+	for (double us : step_us) result.total_step_us += us;
+	std::sort(step_us.begin(), step_us.end());
+	result.p50_us = percentile(step_us, 0.50f);
+	result.p99_us = percentile(step_us, 0.99f);
+	result.allocs_per_frame = result.frames > 0 ? (double)total_allocations / result.frames : 0;
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* boss_arg = "all";
+	int phase_arg = 0; // 0 for all phases
+	float seconds = 10.f;
+	unsigned int seed = 427;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--boss") == 0 && i + 1 < argc) {
+			boss_arg = argv[++i];
+		}
+		else if (strcmp(argv[i], "--phase") == 0 && i + 1 < argc) {
+			++i;
+			phase_arg = strcmp(argv[i], "all") == 0 ? 0 : atoi(argv[i]);
+		}
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+			seconds = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (unsigned int)strtoul(argv[++i], nullptr, 10);
+		}
+		else {
+			printf("Usage: %s [--boss cirno|flandre|sakuya|remilia|all] [--phase 1-4|all] [--seconds <n>] [--seed <n>]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (phase_arg < 0 || phase_arg > BOSS_PHASE_COUNT) {
+		printf("Phase must be between 1 and %d\n", BOSS_PHASE_COUNT);
+		return EXIT_FAILURE;
+	}
+
+	// Only used as a mesh cache, never initialized: no GL context exists.
+	// Intentionally leaked, its destructor releases GL objects.
+	RenderSystem* renderer = new RenderSystem();
+	Mesh& player_mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::REIMU_FRONT);
+	Mesh::loadFromOBJFile(mesh_path("Reimu-Mesh-Front.obj"), player_mesh.vertices, player_mesh.vertex_indices, player_mesh.original_size);
+	// convex hull and edges, as the game's mesh cache provides them to collides_mesh_AABB
+	player_mesh.computeCollisionData();
+
+	printf("Bullet storm benchmark: %.1f simulated seconds per phase, %.2f ms steps, seed %u\n", seconds, STEP_MS, seed);
+	printf("%-8s %5s %7s %12s %12s %10s %10s %12s\n", "boss", "phase", "frames", "peak_bullets", "bullets/s", "p50_us", "p99_us", "allocs/frame");
+
+	bool found = false;
+	for (const BenchBoss& bench_boss : bench_bosses) {
+		if (strcmp(boss_arg, "all") != 0 && strcmp(boss_arg, bench_boss.name) != 0) continue;
+		found = true;
+		for (int phase = 1; phase <= BOSS_PHASE_COUNT; phase++) {
+			if (phase_arg != 0 && phase != phase_arg) continue;
+			PhaseResult r = run_phase(renderer, bench_boss, phase, seconds, seed);
+			double bullets_per_second = r.total_step_us > 0 ? r.bullet_updates / (r.total_step_us / 1000000.0) : 0;
+			printf("%-8s %5d %7d %12zu %12.0f %10.1f %10.1f %12.1f\n", bench_boss.name, phase, r.frames, r.peak_bullets, bullets_per_second, r.p50_us, r.p99_us, r.allocs_per_frame);
+		}
+	}
+	if (!found) {
+		printf("Unknown boss %s\n", boss_arg);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+
+// Application data
+// fog opacity, one texel per grid cell
+uniform sampler2D sampler0;
+uniform vec3 fcolor;
+
+// Output color
+layout(location = 0) out vec4 color;
+
+void main()
+{
+	color = vec4(fcolor, texture(sampler0, texcoord).r);
+}
\ No newline at end of file
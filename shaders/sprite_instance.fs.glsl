@@ -0,0 +1,37 @@
+#version 330
+
+// From vertex shader
+in vec2 texcoord;
+flat in vec3 fcolor;
+flat in vec2 end_pos;
+flat in vec2 scale;
+// sub rectangle of the texture or atlas page
+flat in vec4 uv_rect;
+
+// Application data
+uniform sampler2D sampler0;
+
+// Output color
+layout(location = 0) out  vec4 color;
+
+void main()
+{
+
+    // Calculate offset based on the desired range
+    float offsetX = end_pos.x-scale.x;
+    float offsetY = end_pos.y-scale.y;
+
+    // Apply scale and offset to texture coordinates
+    vec2 constrainedTexcoord = vec2(texcoord.x * scale.x + offsetX, texcoord.y * scale.y + offsetY);
+
+    // Map into the texture's rectangle of the atlas page
+    constrainedTexcoord = uv_rect.xy + constrainedTexcoord * uv_rect.zw;
+
+    // Sample the texture with constrained coordinates
+    if (fcolor.x < 0.0 && fcolor.y < 0.0 && fcolor.z < 0.0) {
+        // white color
+        color = vec4(1.0, 1.0, 1.0, texture(sampler0, constrainedTexcoord).a);
+    } else {
+        color = vec4(fcolor, 1.0) * texture(sampler0, constrainedTexcoord);
+    }
+}
\ No newline at end of file
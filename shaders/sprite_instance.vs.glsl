@@ -0,0 +1,43 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per instance attributes
+in mat3 in_transform;
+in vec3 in_color;
+in vec2 in_end_pos;
+in vec2 in_scale;
+in vec4 in_uv_rect;
+in vec2 in_animation; // { start ms, ms per frame }
+
+// Passed to fragment shader
+out vec2 texcoord;
+flat out vec3 fcolor;
+flat out vec2 end_pos;
+flat out vec2 scale;
+flat out vec4 uv_rect;
+
+// Application data
+uniform mat3 projection;
+uniform mat3 view;
+uniform float time; // uni_timer.animation_ms
+
+void main()
+{
+	texcoord = in_texcoord;
+	fcolor = in_color;
+	end_pos = in_end_pos;
+	// looping sprite sheet, frames left to right, in_end_pos.x is the right edge of the frame shown at start
+	if (in_animation.y > 0.0) {
+		float frame_count = max(floor(1.0 / in_scale.x + 0.5), 1.0);
+		float start_frame = floor(in_end_pos.x / in_scale.x + 0.5) - 1.0;
+		float frame = mod(start_frame + floor((time - in_animation.x) / in_animation.y), frame_count);
+		end_pos.x = (frame + 1.0) * in_scale.x;
+	}
+	scale = in_scale;
+	uv_rect = in_uv_rect;
+	vec3 pos = projection * view * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
\ No newline at end of file
@@ -228,5 +228,4 @@ coord AISystem::get_best_grid_pos(coord& grid_pos, int current_dist, int& retFla
 }
 
 AISystem::AISystem() {
-	rng = std::default_random_engine(std::random_device()());
 }
\ No newline at end of file
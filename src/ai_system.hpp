@@ -77,7 +77,7 @@ private:
 	// Decision tree function
 	bool canSeePlayer(Entity& entity);
 
-	// C++ random number generator
-	std::default_random_engine rng;
+	// C++ random number generator, drawn from the seedable AI substream
+	std::mt19937& rng = rng_service.get(RNG_STREAM::AI);
 	std::uniform_real_distribution<float> uniform_dist{ -1,1 }; // number between -1..1
 };
\ No newline at end of file
@@ -241,8 +241,7 @@ void AISystem::init(VisibilitySystem* visibility_arg, RenderSystem* renderer_arg
 	std::function<void(Entity& entity)> moveRandomDirection = [&](Entity& entity) {
 		if (registry.bulletSpawners.has(entity)) registry.bulletSpawners.get(entity).is_firing = false; // stop firing
 		if (!registry.idleMoveActions.has(entity)) return;
-		std::random_device ran;
-		std::mt19937 gen(ran());
+		std::mt19937& gen = rng_service.get(RNG_STREAM::AI);
 		std::uniform_real_distribution<> dis(-1.0, 1.0);
 		IdleMoveAction& action = registry.idleMoveActions.get(entity);
 		if (action.timer_ms <= 0) {
@@ -519,8 +518,7 @@ void AISystem::init(VisibilitySystem* visibility_arg, RenderSystem* renderer_arg
 	std::function<void(Entity& entity)> moveBossToRandomWaypoint = [&](Entity& entity) {
 		if (uni_timer.boss_can_move_timer < 0 && !registry.followpaths.has(entity) && registry.bosses.has(entity)) {
 			Boss& boss = registry.bosses.get(entity);
-			std::random_device ran;
-			std::mt19937 gen(ran());
+			std::mt19937& gen = rng_service.get(RNG_STREAM::AI);
 			std::uniform_int_distribution<> dis(0, boss.waypoints.size() - 1);
 			int random_number = dis(gen);
 
@@ -1,9 +1,13 @@
 // internal
 #include "animation.hpp"
+#include "particle_system.hpp"
 #include <iostream>
 
 void Animation::step(float elapsed_ms)
 {
+	// looping animations (animation, alwaysplayAni) are not advanced here, their frame is computed from this clock when drawn
+	uni_timer.animation_ms += elapsed_ms;
+
 	for (Entity& animation_entity : registry.animation.entities) {
 		EntityAnimation& animation = registry.animation.get(animation_entity);
 		if (!animation.is_active) continue;
@@ -16,28 +20,6 @@ void Animation::step(float elapsed_ms)
 			animation.state = State::IDLE;
 			animation.offset = 4;
 		}
-		animation.frame_rate_ms -= elapsed_ms;
-
-		if (animation.frame_rate_ms < 0) {
-			animation.render_pos.x += animation.spritesheet_scale.x;
-			if (animation.render_pos.x > 1.0) {
-				animation.render_pos.x = animation.spritesheet_scale.x;
-			}
-			animation.frame_rate_ms = animation.full_rate_ms;
-		}
-	}
-	for (EntityAnimation& animation : registry.alwaysplayAni.components) {
-		if (!animation.is_active) continue;
-
-		animation.frame_rate_ms -= elapsed_ms;
-
-		if (animation.frame_rate_ms < 0) {
-			animation.render_pos.x += animation.spritesheet_scale.x;
-			if (animation.render_pos.x > 1.0) {
-				animation.render_pos.x = animation.spritesheet_scale.x;
-			}
-			animation.frame_rate_ms = animation.full_rate_ms;
-		}
 	}
 
 	ComponentContainer<EntityAnimation>& playonceAni_container = registry.playonceAni;
@@ -56,6 +38,8 @@ void Animation::step(float elapsed_ms)
 			}
 		}
 	}
+	// hit sparks, explosions and other particles
+	particles.step(elapsed_ms);
 
 	double mouse_pos_x;
 	double mouse_pos_y;
@@ -98,6 +82,7 @@ void Animation::step(float elapsed_ms)
 			if (registry.realDeathTimers.get(enemy).first_animation_frame == false) {
 				enemy_ani.render_pos.y = 4 * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -128,6 +113,7 @@ void Animation::step(float elapsed_ms)
 				float offset = registry.bomberEnemies.get(enemy).touch_player ? 8.f : 4.f;
 				enemy_ani.render_pos.y = offset * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -159,6 +145,7 @@ void Animation::step(float elapsed_ms)
 				}
 				enemy_ani.render_pos.y = offset_death * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -190,6 +177,7 @@ void Animation::step(float elapsed_ms)
 				}
 				enemy_ani.render_pos.y = offset_death * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -221,6 +209,7 @@ void Animation::step(float elapsed_ms)
 				}
 				enemy_ani.render_pos.y = offset_death * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -252,6 +241,7 @@ void Animation::step(float elapsed_ms)
 				}
 				enemy_ani.render_pos.y = offset_death * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -283,6 +273,7 @@ void Animation::step(float elapsed_ms)
 				}
 				enemy_ani.render_pos.y = offset_death * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -310,6 +301,7 @@ void Animation::step(float elapsed_ms)
 			if (registry.realDeathTimers.get(enemy).first_animation_frame == false) {
 				enemy_ani.render_pos.y = 4 * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -339,6 +331,7 @@ void Animation::step(float elapsed_ms)
 			if (registry.realDeathTimers.get(enemy).first_animation_frame == false) {
 				enemy_ani.render_pos.y = 4 * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -368,6 +361,7 @@ void Animation::step(float elapsed_ms)
 			if (registry.realDeathTimers.get(enemy).first_animation_frame == false) {
 				enemy_ani.render_pos.y = 4 * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -402,6 +396,7 @@ void Animation::step(float elapsed_ms)
 				}
 				enemy_ani.render_pos.y = offset_death * enemy_ani.spritesheet_scale.y + enemy_ani.render_pos.y;
 				enemy_ani.render_pos.x = enemy_ani.spritesheet_scale.x;
+				enemy_ani.start_ms = uni_timer.animation_ms;
 				registry.realDeathTimers.get(enemy).first_animation_frame = true;
 			}
 		}
@@ -463,7 +458,8 @@ void Animation::step(float elapsed_ms)
 	for (Entity entity : registry.teleporters.entities) {
 		EntityAnimation& ani = registry.alwaysplayAni.get(entity);
 		if (!ani.is_active) continue;
-		if (ani.render_pos.x + ani.spritesheet_scale.x > 1.0) {
+		// a long step can pass the last frame, the count does not wrap around
+		if (ani.get_played_frames(uni_timer.animation_ms) >= ani.get_frame_count() - 1) {
 			ani.render_pos.x = ani.spritesheet_scale.x;
 			ani.is_active = false;
 		}
@@ -472,7 +468,9 @@ void Animation::step(float elapsed_ms)
 	for (Entity entity : registry.aimbotBullets.entities) {
 		EntityAnimation& ani = registry.alwaysplayAni.get(entity);
 		if (!ani.is_active) continue;
-		if (ani.render_pos.x + ani.spritesheet_scale.x > 1.0) {
+		if (ani.get_played_frames(uni_timer.animation_ms) >= ani.get_frame_count() - 1) {
+			// keeps showing the last frame
+			ani.render_pos.x = ani.get_frame_count() * ani.spritesheet_scale.x;
 			ani.is_active = false;
 		}
 	}
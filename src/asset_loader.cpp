@@ -0,0 +1,89 @@
+#include "asset_loader.hpp"
+#include "disk_cache.hpp"
+
+// stlib
+#include <algorithm>
+#include <cassert>
+
+AssetLoader::AssetLoader()
+{
+	int worker_count = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	for (int i = 0; i < worker_count; i++) {
+		workers.emplace_back(&AssetLoader::work, this);
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		is_stopping = true;
+	}
+	jobs_available.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void AssetLoader::work()
+{
+	std::unique_lock<std::mutex> lock(jobs_mutex);
+	while (true) {
+		jobs_available.wait(lock, [this]() { return is_stopping || !jobs.empty() || next_range < range_count; });
+		// parallel_for ranges go first, the calling thread is waiting for them
+		if (run_next_range(lock)) continue;
+		if (jobs.empty()) return;
+		{
+			std::function<void()> job = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+			job();
+		}
+		lock.lock();
+	}
+}
+
+bool AssetLoader::run_next_range(std::unique_lock<std::mutex>& lock)
+{
+	if (next_range >= range_count) return false;
+	int range = next_range++;
+	int first = range * range_size;
+	int last = std::min(first + range_size, range_item_count);
+	lock.unlock();
+	run_range(range_job, range, first, last);
+	lock.lock();
+	if (--ranges_left == 0) {
+		ranges_done.notify_one();
+	}
+	return true;
+}
+
+void AssetLoader::run_ranges(int count, int range_size, int range_count, const void* job, RangeRunner run_range)
+{
+	std::unique_lock<std::mutex> lock(jobs_mutex);
+	assert(this->range_count == 0 && "parallel_for is not reentrant");
+	range_job = job;
+	this->run_range = run_range;
+	range_item_count = count;
+	this->range_size = range_size;
+	next_range = 0;
+	ranges_left = range_count;
+	this->range_count = range_count;
+	jobs_available.notify_all();
+
+	// the calling thread takes ranges too, it would only wait otherwise
+	while (run_next_range(lock)) {}
+	ranges_done.wait(lock, [this]() { return ranges_left == 0; });
+	this->range_count = 0;
+	next_range = 0;
+}
+
+std::future<std::vector<unsigned char>> AssetLoader::read_file(const std::string& path)
+{
+	return submit([path]() {
+		std::vector<unsigned char> bytes;
+		// the shared helper, not this member
+		if (!::read_file(path, bytes)) bytes.clear();
+		return bytes;
+	});
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Worker pool decoding assets while the main thread sets up the window, e.g.
+//   std::future<bool> parsed = asset_loader.submit([&]() { return Mesh::loadFromOBJFile(...); });
+//   ... create the GL context ...
+//   if (parsed.get()) bindVBOandIBO(...);
+// Jobs must not call GL or touch the registry, results are uploaded on the main thread
+// Once startup is done the workers also build draw lists, see parallel_for
+class AssetLoader {
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobs_mutex;
+	std::condition_variable jobs_available;
+	bool is_stopping = false;
+
+	// The running parallel_for, set up once per call without allocating, guarded by jobs_mutex
+	// Range r covers [r * range_size, min((r + 1) * range_size, range_item_count))
+	using RangeRunner = void (*)(const void* job, int range, int first, int last);
+	const void* range_job = nullptr;
+	RangeRunner run_range = nullptr;
+	int range_item_count = 0;
+	int range_size = 0;
+	// 0 while no parallel_for runs
+	int range_count = 0;
+	// next range not yet claimed by a worker or the calling thread
+	int next_range = 0;
+	// ranges not yet finished, the calling thread waits on ranges_done for 0
+	int ranges_left = 0;
+	std::condition_variable ranges_done;
+
+	void work();
+	// Claims and runs the next range of the running parallel_for, false if all are claimed
+	// lock must hold jobs_mutex, it is released while the range runs
+	bool run_next_range(std::unique_lock<std::mutex>& lock);
+	void run_ranges(int count, int range_size, int range_count, const void* job, RangeRunner run_range);
+public:
+	// Starts one worker per hardware thread, leaving one for the main thread
+	AssetLoader();
+	// Finishes the queued jobs
+	~AssetLoader();
+
+	template <typename Job>
+	std::future<decltype(std::declval<Job>()())> submit(Job job)
+	{
+		using Result = decltype(job());
+		// std::function needs a copyable target, packaged_task is move only
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+		std::future<Result> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(jobs_mutex);
+			jobs.push_back([task]() { (*task)(); });
+		}
+		jobs_available.notify_one();
+		return result;
+	}
+
+	// Reads the whole file at path, empty if it can not be read
+	std::future<std::vector<unsigned char>> read_file(const std::string& path);
+
+	// Most ranges parallel_for splits work into, e.g. the size of per-range output arrays
+	int max_ranges() const { return (int)workers.size() + 1; }
+
+	// Splits [0, count) into ranges of at least min_range_size items and calls job(range, first, last) for each,
+	// on the workers and the calling thread, returns once all ranges are done
+	// Small counts run on the calling thread only. Jobs may read the registry while the calling thread waits,
+	// e.g. in RenderSystem::draw, but must not insert or remove components
+	// Called every frame, it allocates nothing. Not reentrant: one thread calls it at a time, jobs never do
+	template <typename Job>
+	void parallel_for(int count, int min_range_size, const Job& job)
+	{
+		if (count <= 0) return;
+		int range_count = std::min(max_ranges(), std::max(count / std::max(min_range_size, 1), 1));
+		int range_size = (count + range_count - 1) / range_count;
+		// rounding range_size up can leave trailing ranges empty
+		range_count = (count + range_size - 1) / range_size;
+		if (range_count == 1) {
+			job(0, 0, count);
+			return;
+		}
+		run_ranges(count, range_size, range_count, &job, [](const void* job, int range, int first, int last) {
+			(*(const Job*)job)(range, first, last);
+		});
+	}
+};
+
+// Returns the index of a ready future in futures, waiting for the first not yet taken one if none is ready
+// taken marks futures whose result was already used
+template <typename T>
+int wait_any(std::vector<std::future<T>>& futures, const std::vector<bool>& taken)
+{
+	int first = -1;
+	for (size_t i = 0; i < futures.size(); i++) {
+		if (taken[i]) continue;
+		if (first == -1) first = (int)i;
+		if (futures[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready) return (int)i;
+	}
+	if (first != -1) futures[first].wait();
+	return first;
+}
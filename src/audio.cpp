@@ -108,23 +108,50 @@ Audio::Audio() {
 		fprintf(stderr, "Failed to open audio device");
 		assert(false && "Failed to open audio device");
 	}
+}
+
+std::vector<std::pair<Mix_Chunk**, std::string>> Audio::get_sound_files() {
+	return {
+		{ &level1_background_music, "level1_background_music.wav" },
+		{ &level2_background_music, "level2_background_music.wav" },
+		{ &level3_background_music, "level3_background_music.wav" },
+		{ &level4_background_music, "level4_background_music.wav" },
+		{ &menu_music, "main_menu_bgm.wav" },
+		{ &cirno_boss_music, "cirno_boss_fight.wav" },
+		{ &game_ending_sound, "game_ending_sound.wav" },
+		{ &firing_sound, "spell_sound.wav" },
+		{ &damage_sound, "damage_sound.wav" },
+		{ &hit_spell, "hit_spell.wav" },
+		{ &pause_menu_sound, "pause_menu_sound.wav" },
+		{ &open_gate_sound, "open_gate_sound.wav" },
+		{ &flandre_boss_music, "flandre_boss_fight.wav" },
+		{ &remilia_boss_music, "remilia_boss_fight.wav" },
+		{ &sakuya_boss_music, "sakuya_boss_fight.wav" },
+		{ &tutorial_background_music, "tutorial.wav" },
+	};
+}
 
-	level1_background_music = Mix_LoadWAV(audio_path("level1_background_music.wav").c_str());
-	level2_background_music = Mix_LoadWAV(audio_path("level2_background_music.wav").c_str());
-	level3_background_music = Mix_LoadWAV(audio_path("level3_background_music.wav").c_str());
-	level4_background_music = Mix_LoadWAV(audio_path("level4_background_music.wav").c_str());
-	menu_music = Mix_LoadWAV(audio_path("main_menu_bgm.wav").c_str());
-	cirno_boss_music = Mix_LoadWAV(audio_path("cirno_boss_fight.wav").c_str());
-	game_ending_sound = Mix_LoadWAV(audio_path("game_ending_sound.wav").c_str());
-	firing_sound = Mix_LoadWAV(audio_path("spell_sound.wav").c_str());
-	damage_sound = Mix_LoadWAV(audio_path("damage_sound.wav").c_str());
-	hit_spell = Mix_LoadWAV(audio_path("hit_spell.wav").c_str());
-	pause_menu_sound = Mix_LoadWAV(audio_path("pause_menu_sound.wav").c_str());
-	open_gate_sound = Mix_LoadWAV(audio_path("open_gate_sound.wav").c_str());
-	flandre_boss_music = Mix_LoadWAV(audio_path("flandre_boss_fight.wav").c_str());
-	remilia_boss_music = Mix_LoadWAV(audio_path("remilia_boss_fight.wav").c_str());
-	sakuya_boss_music = Mix_LoadWAV(audio_path("sakuya_boss_fight.wav").c_str());
-	tutorial_background_music = Mix_LoadWAV(audio_path("tutorial.wav").c_str());
+void Audio::load_assets(AssetLoader& asset_loader) {
+	sound_file_jobs.clear();
+	for (auto& sound_file : get_sound_files()) {
+		sound_file_jobs.push_back(asset_loader.read_file(audio_path(sound_file.second)));
+	}
+}
+
+void Audio::init() {
+	std::unique_ptr<AssetLoader> local_asset_loader;
+	if (sound_file_jobs.empty()) {
+		local_asset_loader = std::make_unique<AssetLoader>();
+		load_assets(*local_asset_loader);
+	}
+
+	// SDL_mixer converts the sounds to the device format here, only the file reads run on workers
+	std::vector<std::pair<Mix_Chunk**, std::string>> sound_files = get_sound_files();
+	for (size_t i = 0; i < sound_files.size(); i++) {
+		std::vector<unsigned char> bytes = sound_file_jobs[i].get();
+		*sound_files[i].first = bytes.empty() ? nullptr : Mix_LoadWAV_RW(SDL_RWFromConstMem(bytes.data(), (int)bytes.size()), 1);
+	}
+	sound_file_jobs.clear();
 
 	Mix_PlayChannel(1, menu_music, -1);
 	Mix_PlayChannel(2, level1_background_music, -1);
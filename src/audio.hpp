@@ -8,6 +8,7 @@
 #include "common.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "asset_loader.hpp"
 
 struct audio {
 	int channel = -1;
@@ -26,9 +27,16 @@ struct audio {
 
 class Audio {
 public:
+	// Opens the audio device, sounds are loaded by load_assets and init
 	Audio();
 	~Audio();
 
+	// Start reading every sound file on asset_loader's workers, asset_loader must outlive init
+	void load_assets(AssetLoader& asset_loader);
+	// Create the sounds from the files read and start the menu music
+	// Files are read on a local AssetLoader if load_assets was not called
+	void init();
+
 	// restart audio playing
 	void restart_audio_level();
 	void restart_audio_boss();
@@ -38,24 +46,30 @@ public:
 	void step(float elapsed);
 
 	// music references
-	Mix_Chunk* level1_background_music;
-	Mix_Chunk* level2_background_music;
-	Mix_Chunk* level3_background_music;
-	Mix_Chunk* level4_background_music;
-	Mix_Chunk* menu_music;
-	Mix_Chunk* tutorial_background_music;
-	Mix_Chunk* open_gate_sound;
-	Mix_Chunk* cirno_boss_music;
-	Mix_Chunk* pause_menu_sound;
-	Mix_Chunk* game_ending_sound;
-	Mix_Chunk* firing_sound;
-	Mix_Chunk* damage_sound;
-	Mix_Chunk* hit_spell;
-	Mix_Chunk* flandre_boss_music;
-	Mix_Chunk* remilia_boss_music;
-	Mix_Chunk* sakuya_boss_music;
+	Mix_Chunk* level1_background_music = nullptr;
+	Mix_Chunk* level2_background_music = nullptr;
+	Mix_Chunk* level3_background_music = nullptr;
+	Mix_Chunk* level4_background_music = nullptr;
+	Mix_Chunk* menu_music = nullptr;
+	Mix_Chunk* tutorial_background_music = nullptr;
+	Mix_Chunk* open_gate_sound = nullptr;
+	Mix_Chunk* cirno_boss_music = nullptr;
+	Mix_Chunk* pause_menu_sound = nullptr;
+	Mix_Chunk* game_ending_sound = nullptr;
+	Mix_Chunk* firing_sound = nullptr;
+	Mix_Chunk* damage_sound = nullptr;
+	Mix_Chunk* hit_spell = nullptr;
+	Mix_Chunk* flandre_boss_music = nullptr;
+	Mix_Chunk* remilia_boss_music = nullptr;
+	Mix_Chunk* sakuya_boss_music = nullptr;
 
 	audio abackground_music;
 	audio amenu_music;
 	audio aboss_music;
+
+private:
+	// sound reference and file name in the audio folder
+	std::vector<std::pair<Mix_Chunk**, std::string>> get_sound_files();
+	// file contents of get_sound_files, same order
+	std::vector<std::future<std::vector<unsigned char>>> sound_file_jobs;
 };
\ No newline at end of file
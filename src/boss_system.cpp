@@ -1,4 +1,5 @@
 #include "boss_system.hpp"
+#include "world_init.hpp"
 
 BossSystem::BossSystem() {
 	init_phases();
@@ -13,8 +14,7 @@ void BossSystem::step(float elapsed_ms) {
 		if (boss.phase_index < boss.health_phase_thresholds.size() &&
 			hp.curr_hp <= boss.health_phase_thresholds[boss.phase_index]) {
 			boss.phase_index++;
-			std::random_device ran;
-			std::mt19937 gen(ran());
+			std::mt19937& gen = rng_service.get(RNG_STREAM::BOSS);
 			set_random_phase(boss, gen, entity);
 
 			// ignore index 0 phase, as boss does not attack in phase 0. this can be changed if index 0 is firing bullets.
@@ -35,8 +35,7 @@ void BossSystem::step(float elapsed_ms) {
 				}
 
 				// remove all bullets
-				while (registry.enemyBullets.entities.size() > 0)
-					registry.remove_all_components_of(registry.enemyBullets.entities.back());
+				removeEnemyBullets(boss.dissolve_bullets_on_phase_change);
 			}
 		}
 
@@ -45,8 +44,7 @@ void BossSystem::step(float elapsed_ms) {
 			if (boss.current_duration >= boss.duration) {
 				// prevent random phase change during firing
 				if (registry.bulletSpawners.has(entity) && registry.bulletSpawners.get(entity).is_cooldown) {
-					std::random_device ran;
-					std::mt19937 gen(ran());
+					std::mt19937& gen = rng_service.get(RNG_STREAM::BOSS);
 					set_random_phase(boss, gen, entity);
 					boss.current_duration = 0;
 				}
@@ -755,7 +753,7 @@ REFERENCE:
 Bullet actions: (parameter argument specification)
 None:
 PLAYER_DIRECTION - change bullet to face player direction (only for enemies)
-ENEMY_DIRECTION - change bullet to face direction of deadly closest to cursor (only for players)
+ENEMY_DIRECTION - change bullet to face direction of deadly closest to the bullet (only for players)
 CURSOR_DIRECTION - change bullet to face direction cursor (only for players)
 RANDOM_DIRECTION - change bullet to random direction
 
@@ -15,7 +15,6 @@ void BSPTree::init(vec2 max_room_size, vec2 world_size) {
 	// No need to create padding yet, that will be handled when generating tiles
 	root = new BSPNode(vec2(0), world_size);
 	//root = new BSPNode(vec2(1), world_size - vec2(1));
-	gen.seed(std::random_device{}());
 }
 
 BSPNode* BSPTree::generate_partitions(BSPNode* node) {
@@ -115,8 +114,8 @@ void BSPTree::generate_corridors(BSPNode* node) {
 		std::uniform_int_distribution<> int_distrib_ly(lNode->room->top_left.y, lNode->room->bottom_right.y);
 
 		// random point in both room gives more variety
-		vec2 start = vec2(int_distrib_rx(rng), int_distrib_ry(rng));
-		vec2 end = vec2(int_distrib_lx(rng), int_distrib_ly(rng));
+		vec2 start = vec2(int_distrib_rx(gen), int_distrib_ry(gen));
+		vec2 end = vec2(int_distrib_lx(gen), int_distrib_ly(gen));
 
 		// center point of both room
 		//vec2 start = vec2((rNode->room->bottom_left + rNode->room->top_left) / 2.f);
@@ -40,8 +40,8 @@ private:
 	// Maximum room size
 	vec2 max_room_size;
 
-	// C++ random number generator
-	std::default_random_engine rng;
+	// C++ random number generator, drawn from the seedable BSP substream
+	std::mt19937& gen = rng_service.get(RNG_STREAM::BSP);
 	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 public:
 	BSPNode* root = nullptr;
@@ -63,7 +63,6 @@ public:
 
 private:
 	// Utilities:
-	std::mt19937 gen;
 
 	// Modified A-star for corridors in an attempt to solve overlap
 	// Taken from ai_system_init.cpp
@@ -52,9 +52,10 @@ void BulletSystem::step(float elapsed_ms)
 			Motion& motion = registry.motions.get(entity);
 			Kinematic& kinematic = registry.kinematics.get(entity);
 
-			Transform transform;
-			transform.rotate(radians(bullet_spawner.start_angle));
-			vec2 initial_dir = transform.mat * vec3(1, 0, 1);
+			// spinning start angle is applied as a single rotation to the aim direction
+			float start_radians = radians(bullet_spawner.start_angle);
+			vec2 spin = { cosf(start_radians), sinf(start_radians) };
+			vec2 initial_dir = spin;
 
 			// this is referencing an object on the stack
 			// however, createBullet will create a copy when vector.push_back in components
@@ -78,7 +79,7 @@ void BulletSystem::step(float elapsed_ms)
 
 				Mix_PlayChannel(-1, audio->firing_sound, 0);
 				player_bullet_spawn_pos = motion.position + shift_forward + shift_down;
-				initial_dir = transform.mat * vec3(last_mouse_position - motion.position - shift_down, 1.0f);
+				initial_dir = rotate_direction(last_mouse_position - motion.position - shift_down, spin);
 
 				Player& player = registry.players.components[0];
 				switch (player.ammo_type) {
@@ -123,38 +124,31 @@ void BulletSystem::step(float elapsed_ms)
 				}
 			}
 			// need to check boss first, since boss also have deadly component
-			else if (registry.bosses.has(entity)) {
-				initial_dir = transform.mat * vec3(1, 0, 1);
-			}
-			else if (registry.bossInvisibles.has(entity)) {
-				initial_dir = transform.mat * vec3(1, 0, 1);
+			else if (registry.bosses.has(entity) || registry.bossInvisibles.has(entity)) {
+				// initial direction is the spin itself
 			}
 			else if (registry.deadlys.has(entity)) {
 				Motion& player_motion = registry.motions.get(player);
 				vec2 player_dir = player_motion.position - motion.position;
 				//float enemy_fire_angle = -atan2(x, y) - glm::radians(90.0f);
-				initial_dir = transform.mat * vec3(normalize(player_dir), 1);
+				initial_dir = rotate_direction(normalize(player_dir), spin);
 			}
 
-			std::vector<vec2> initial_bullet_directions = { normalize(initial_dir) };
-			set_bullet_directions(bullet_spawner.total_bullet_array, bullet_spawner.spread_between_array, transform, initial_dir, initial_bullet_directions);
-			// Set relative bullet directions
-			std::vector<vec2> bullet_direcions;
-			for (int i = 0; i < initial_bullet_directions.size(); ++i) {
-				set_bullet_directions(bullet_spawner.bullets_per_array, bullet_spawner.spread_within_array, transform, initial_bullet_directions[i], bullet_direcions);
-			}
+			// Set bullet directions from the cached table of this spawner configuration
+			const std::vector<vec2>& spread_table = get_spread_table(bullet_spawner.total_bullet_array, bullet_spawner.bullets_per_array,
+				bullet_spawner.spread_between_array, bullet_spawner.spread_within_array);
+			set_volley_directions(spread_table, initial_dir);
+
 			// Spawn bullets
 			if (entity == player) {
-				spawn_bullets(renderer, initial_bullet_directions, bullet_spawner.bullet_initial_speed, player_bullet_spawn_pos, kinematic, true, player_bullet_pattern_ptr);
-				spawn_bullets(renderer, bullet_direcions, bullet_spawner.bullet_initial_speed, player_bullet_spawn_pos, kinematic, true, player_bullet_pattern_ptr);
+				spawn_bullets(renderer, volley_directions, bullet_spawner.bullet_initial_speed, player_bullet_spawn_pos, kinematic, true, player_bullet_pattern_ptr);
 			}
 			else if (registry.bosses.has(entity)) {
 				Boss& boss = registry.bosses.get(entity);
 				bool has_patterns = boss.bullet_pattern.commands.size() != 0;
 				BulletPattern* bullet_pattern = nullptr;
 				if (has_patterns) bullet_pattern = &boss.bullet_pattern;
-				spawn_bullets(renderer, initial_bullet_directions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false, bullet_pattern);
-				spawn_bullets(renderer, bullet_direcions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false, bullet_pattern);
+				spawn_bullets(renderer, volley_directions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false, bullet_pattern);
 			}
 			else if (registry.bossInvisibles.has(entity)) {
 				BossInvisible& invis = registry.bossInvisibles.get(entity);
@@ -162,18 +156,15 @@ void BulletSystem::step(float elapsed_ms)
 				bool has_patterns = invis.bullet_pattern.commands.size() != 0;
 				BulletPattern* bullet_pattern = nullptr;
 				if (has_patterns) bullet_pattern = &invis.bullet_pattern;
-				spawn_bullets(renderer, initial_bullet_directions, bullet_spawner.bullet_initial_speed, motion.position, boss_kin, false, bullet_pattern);
-				spawn_bullets(renderer, bullet_direcions, bullet_spawner.bullet_initial_speed, motion.position, boss_kin, false, bullet_pattern);
+				spawn_bullets(renderer, volley_directions, bullet_spawner.bullet_initial_speed, motion.position, boss_kin, false, bullet_pattern);
 			}
 			else if (registry.deadlys.has(entity)) {
 				Deadly& deadly = registry.deadlys.get(entity);
 				BulletPattern* bullet_pattern = deadly.has_bullet_pattern ? &deadly.bullet_pattern : nullptr;
-				spawn_bullets(renderer, initial_bullet_directions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false, bullet_pattern);
-				spawn_bullets(renderer, bullet_direcions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false, bullet_pattern);
+				spawn_bullets(renderer, volley_directions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false, bullet_pattern);
 			}
 			else {
-				spawn_bullets(renderer, initial_bullet_directions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false);
-				spawn_bullets(renderer, bullet_direcions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false);
+				spawn_bullets(renderer, volley_directions, bullet_spawner.bullet_initial_speed, motion.position, kinematic, false);
 			}
 
 			if (bullet_spawner.number_to_fire != -1) {
@@ -282,12 +273,12 @@ void BulletSystem::step(float elapsed_ms)
 				if (info[0] <= 1) break;
 				Kinematic& bullet_kinematic = registry.kinematics.get(entity);
 				Motion& bullet_motion = registry.motions.get(entity);
-				Transform transform;
-				// if direction is (0,0), set_bullet_directions will return bullets that also have direction (0,0)
+				// if direction is (0,0), split bullets would also have direction (0,0)
 				if (bullet_kinematic.direction.x == 0 && bullet_kinematic.direction.y == 0) bullet_kinematic.direction = { 1, 0 };
-				std::vector<vec2> bullet_directions = { bullet_kinematic.direction };
-				set_bullet_directions(info[0] + 1, info[1], transform, bullet_kinematic.direction, bullet_directions);
-				spawn_bullets(renderer, bullet_directions, info[2], bullet_motion.position, bullet_kinematic, false);
+				// a split is a single array of info[0] + 1 bullets
+				const std::vector<vec2>& spread_table = get_spread_table((int)info[0] + 1, 1, info[1], 0.f);
+				set_volley_directions(spread_table, bullet_kinematic.direction);
+				spawn_bullets(renderer, volley_directions, info[2], bullet_motion.position, bullet_kinematic, false);
 				registry.bulletDeathTimers.emplace(entity); // delete original bullet
 				break;
 			}
@@ -306,11 +297,13 @@ void BulletSystem::step(float elapsed_ms)
 				break;
 			}
 			case BULLET_ACTION::ENEMY_DIRECTION: {
-				if (uni_timer.closest_enemy == -1) break;
-				Entity deadly_entity = (Entity)uni_timer.closest_enemy;
+				// each bullet homes in on the enemy closest to itself
+				Motion& bullet_motion = registry.motions.get(entity);
+				int closest_enemy = enemy_grid.nearest(bullet_motion.position, LOCK_ON_RANGE_TILES * world_tile_size);
+				if (closest_enemy == -1) break;
+				Entity deadly_entity = (Entity)closest_enemy;
 				if (registry.deadlys.has(deadly_entity)) {
 					Kinematic& bullet_kinematic = registry.kinematics.get(entity);
-					Motion& bullet_motion = registry.motions.get(entity);
 					// direction will be normalized in physics system
 					bullet_kinematic.direction = registry.motions.get(deadly_entity).position - bullet_motion.position;
 				}
@@ -334,8 +327,7 @@ void BulletSystem::step(float elapsed_ms)
 				break;
 			}
 			case BULLET_ACTION::RANDOM_DIRECTION: {
-				std::random_device ran;
-				std::mt19937 gen(ran());
+				std::mt19937& gen = rng_service.get(RNG_STREAM::BULLET);
 				std::uniform_real_distribution<float> dis(-1, 1);
 				Kinematic& bullet_kinematic = registry.kinematics.get(entity);
 				bullet_kinematic.direction = vec2(dis(gen), dis(gen));
@@ -368,6 +360,16 @@ void BulletSystem::step(float elapsed_ms)
 		}
 	}
 
+	// Shrink and remove batched bullet dissolves
+	ComponentContainer<BulletDissolve>& bullet_dissolve_container = registry.bulletDissolves;
+	for (int i = (int)bullet_dissolve_container.components.size() - 1; i >= 0; --i) {
+		BulletDissolve& bullet_dissolve = bullet_dissolve_container.components[i];
+		bullet_dissolve.counter_ms -= elapsed_ms;
+		if (bullet_dissolve.counter_ms < 0) {
+			registry.remove_all_components_of(bullet_dissolve_container.entities[i]);
+		}
+	}
+
 	// Remove bullet firing timer
 	ComponentContainer<BulletStartFiringTimer>& bullet_stop_firing_container = registry.bulletStartFiringTimers;
 	int bullet_stop_firing_container_size = bullet_stop_firing_container.components.size();
@@ -396,29 +398,54 @@ void BulletSystem::step(float elapsed_ms)
 	}
 }
 
-void spawn_bullets(RenderSystem* renderer, std::vector<vec2>& initial_bullet_directions, float bullet_initial_speed, vec2 spawn_position, Kinematic& kinematic, bool is_player_bullet, BulletPattern* bullet_pattern)
+const std::vector<vec2>& BulletSystem::get_spread_table(int total_bullet_array, int bullets_per_array, float spread_between_array, float spread_within_array)
 {
-	for (int i = 0; i < initial_bullet_directions.size(); ++i) {
-		createBullet(renderer, kinematic.speed_modified, spawn_position, 0, initial_bullet_directions[i], bullet_initial_speed, is_player_bullet, bullet_pattern, false);
+	std::tuple<int, int, float, float> key = { total_bullet_array, bullets_per_array, spread_between_array, spread_within_array };
+	auto it = spread_tables.find(key);
+	if (it != spread_tables.end()) return it->second;
+
+	// equally distribute above/below initial direction, e.g. 0, +1, -1, +2, -2, ...
+	auto angle_factor = [](int i) { return i % 2 == 0 ? -i / 2 : (i + 1) / 2; };
+
+	// first one bullet per array, then the remaining bullets of each array
+	std::vector<float> angles;
+	int total_arrays = max(total_bullet_array, 1);
+	for (int i = 0; i < total_arrays; ++i) {
+		angles.push_back(spread_between_array * angle_factor(i));
+	}
+	for (int i = 0; i < total_arrays; ++i) {
+		for (int j = 1; j < bullets_per_array; ++j) {
+			angles.push_back(angles[i] + spread_within_array * angle_factor(j));
+		}
+	}
+
+	std::vector<vec2>& table = spread_tables[key];
+	table.reserve(angles.size());
+	for (float angle : angles) {
+		table.push_back({ cosf(radians(angle)), sinf(radians(angle)) });
 	}
+	return table;
 }
 
-void set_bullet_directions(int number_bullets, float spread_angle, Transform& transform, glm::vec2& initial_dir, path& bullet_directions)
+void BulletSystem::set_volley_directions(const std::vector<vec2>& spread_table, vec2 initial_dir)
 {
-	for (int i = 1; i < number_bullets; ++i) {
-		// equally distribute above/below initial direction
-		int angle_factor;
-		if (i % 2 == 0) {
-			angle_factor = -i / 2;
-		}
-		else {
-			angle_factor = (i + 1) / 2;
-		}
-		float angle = spread_angle * angle_factor;
-		transform.mat = mat3(1.0f);
-		transform.rotate(radians(angle));
-		vec2 ith_direction = transform.mat * vec3(initial_dir, 1.0);
-		bullet_directions.push_back(normalize(ith_direction));
+	vec2 dir = normalize(initial_dir);
+	volley_directions.resize(spread_table.size());
+	for (size_t i = 0; i < spread_table.size(); ++i) {
+		volley_directions[i] = rotate_direction(dir, spread_table[i]);
 	}
 }
 
+vec2 rotate_direction(vec2 dir, vec2 rotation)
+{
+	return { rotation.x * dir.x - rotation.y * dir.y, rotation.y * dir.x + rotation.x * dir.y };
+}
+
+void spawn_bullets(RenderSystem* renderer, const std::vector<vec2>& initial_bullet_directions, float bullet_initial_speed, vec2 spawn_position, Kinematic& kinematic, bool is_player_bullet, BulletPattern* bullet_pattern)
+{
+	// createBullet grows the kinematics container, so read the speed before kinematic can be moved
+	float entity_speed = kinematic.speed_modified;
+	for (int i = 0; i < initial_bullet_directions.size(); ++i) {
+		createBullet(renderer, entity_speed, spawn_position, 0, initial_bullet_directions[i], bullet_initial_speed, is_player_bullet, bullet_pattern, false);
+	}
+}
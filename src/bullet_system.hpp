@@ -6,10 +6,13 @@
 #include "world_system.hpp"
 #include "audio.hpp"
 #include "global.hpp"
+#include "spatial_grid.hpp"
 
 #include <glm/trigonometric.hpp> // for glm::radians
 #include <glm/glm.hpp>
 
+#include <map>
+
 class BulletSystem
 {
 	const size_t MAX_BULLETS = 999;
@@ -19,6 +22,16 @@ class BulletSystem
 	vec2 last_mouse_position = { 0, 0 };
 	vec2 player_bullet_spawn_pos;
 
+	// Volley direction tables, keyed by the spawner fields that shape a volley:
+	// (total_bullet_array, bullets_per_array, spread_between_array, spread_within_array)
+	// Each entry is a unit rotation (cos, sin) relative to the volley's initial direction
+	std::map<std::tuple<int, int, float, float>, std::vector<vec2>> spread_tables;
+	// Reused every volley so firing does not allocate
+	std::vector<vec2> volley_directions;
+
+	const std::vector<vec2>& get_spread_table(int total_bullet_array, int bullets_per_array, float spread_between_array, float spread_within_array);
+	void set_volley_directions(const std::vector<vec2>& spread_table, vec2 initial_dir);
+
 	// Misc
 	RenderSystem* renderer;
 	GLFWwindow* window;
@@ -29,6 +42,7 @@ public:
 	void step(float elapsed_ms);
 };
 
-void set_bullet_directions(int number_bullets, float spread_angle, Transform& transform, glm::vec2& initial_dir, path& bullet_directions);
+// Rotates dir by the unit rotation (cos, sin), same as Transform::rotate without building a matrix
+vec2 rotate_direction(vec2 dir, vec2 rotation);
 
-void spawn_bullets(RenderSystem* renderer, std::vector<vec2>& initial_bullet_directions, float bullet_initial_speed, vec2 spawn_position, Kinematic& kinematic, bool is_player_bullet = false, BulletPattern* bullet_pattern = nullptr);
+void spawn_bullets(RenderSystem* renderer, const std::vector<vec2>& initial_bullet_directions, float bullet_initial_speed, vec2 spawn_position, Kinematic& kinematic, bool is_player_bullet = false, BulletPattern* bullet_pattern = nullptr);
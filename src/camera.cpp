@@ -51,6 +51,18 @@ void Camera::setCameraAABB() {
 	right = camera_center.x + offset_from_center.x;
 }
 
+vec2 Camera::getViewMin() {
+	return { left, top };
+}
+
+vec2 Camera::getViewMax() {
+	return { right, bottom };
+}
+
 bool Camera::isInCameraView(vec2 position) {
 	return position.y >= top && position.y <= bottom && position.x >= left && position.x <= right;
+}
+
+bool Camera::isInCameraView(vec2 min_position, vec2 max_position) {
+	return max_position.y >= top && min_position.y <= bottom && max_position.x >= left && min_position.x <= right;
 }
\ No newline at end of file
@@ -48,8 +48,13 @@ public:
 	// Checks whether the position is inside the camera screen view
 	// Used for optimizing rendering by rendering only entities inside of the screen
 	bool isInCameraView(vec2 position);
+	// Checks whether the box overlaps the camera screen view
+	bool isInCameraView(vec2 min_position, vec2 max_position);
 	// Set camera's AABB used to cull entities with render request outside of screen
 	void setCameraAABB();
+	// Top left and bottom right corner of the camera's AABB
+	vec2 getViewMin();
+	vec2 getViewMax();
 
 	mat3 createViewMatrix();
 	void print(); // for debugging
@@ -21,6 +21,22 @@ void Transform::translate(vec2 offset)
 	mat = mat * T;
 }
 
+RandomService rng_service;
+
+RandomService::RandomService()
+{
+	set_seed(std::random_device()());
+}
+
+void RandomService::set_seed(unsigned int seed)
+{
+	this->seed = seed;
+	for (int i = 0; i < (int)RNG_STREAM::STREAM_COUNT; ++i) {
+		std::seed_seq seq = { seed, (unsigned int)i };
+		streams[i].seed(seq);
+	}
+}
+
 bool gl_has_errors()
 {
 	//GLenum error = glGetError();
@@ -73,6 +73,32 @@ struct Transform {
 
 bool gl_has_errors();
 
+// Independent random streams, one per system, so changing how often one system
+// draws numbers does not shift the sequence of another
+enum class RNG_STREAM {
+	WORLD,
+	MAP,
+	BSP,
+	AI,
+	BULLET,
+	BOSS,
+	STREAM_COUNT
+};
+
+// All simulation randomness goes through here, a single seed reproduces a run
+// e.g. std::uniform_real_distribution<> dis(0, 1); dis(rng_service.get(RNG_STREAM::BOSS));
+class RandomService {
+	unsigned int seed = 0;
+	std::mt19937 streams[(int)RNG_STREAM::STREAM_COUNT];
+public:
+	RandomService();
+	// Reseeds every stream, each stream gets its own seed sequence derived from seed
+	void set_seed(unsigned int seed);
+	unsigned int get_seed() { return seed; }
+	std::mt19937& get(RNG_STREAM stream) { return streams[(int)stream]; }
+};
+extern RandomService rng_service;
+
 vec2 vec2_lerp(vec2 start, vec2 end, float t);
 float float_lerp(float start, float end, float t);
 
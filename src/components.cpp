@@ -5,6 +5,7 @@
 #include "../ext/stb_image/stb_image.h"
 
 // stlib
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -131,3 +132,90 @@ bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out
 
 	return true;
 }
+
+int EntityAnimation::get_frame_count() const
+{
+	if (spritesheet_scale.x <= 0) return 1;
+	return std::max((int)round(1.f / spritesheet_scale.x), 1);
+}
+
+int EntityAnimation::get_played_frames(float time_ms) const
+{
+	if (spritesheet_scale.x <= 0) return 0;
+	// render_pos.x is the right edge of its frame
+	int frame = (int)round(render_pos.x / spritesheet_scale.x) - 1;
+	if (is_active && full_rate_ms > 0) {
+		frame += (int)floor((time_ms - start_ms) / full_rate_ms);
+	}
+	return frame;
+}
+
+int EntityAnimation::get_frame(float time_ms) const
+{
+	int frame_count = get_frame_count();
+	int frame = get_played_frames(time_ms) % frame_count;
+	return frame < 0 ? frame + frame_count : frame;
+}
+
+vec2 EntityAnimation::get_end_pos(float time_ms) const
+{
+	if (spritesheet_scale.x <= 0) return render_pos;
+	return { (get_frame(time_ms) + 1) * spritesheet_scale.x, render_pos.y };
+}
+
+static bool is_leftturn(const vec3& p, const vec3& q, const vec3& r) {
+	float val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
+	return (val > 0);
+}
+
+static float square_dist(const vec3& p1, const vec3& p2) {
+	return (p1.x - p2.x) * (p1.x - p2.x) + (p1.y - p2.y) * (p1.y - p2.y);
+}
+
+void Mesh::computeCollisionData()
+{
+	// Graham's Scan algorithm for finding convex hulls in counter-clockwise order. Reference CPSC 420: Advanced Algorithms
+	std::vector<vec3> sorted;
+	for (const ColoredVertex& vertex : vertices)
+		sorted.push_back(vertex.position);
+	int n = (int)sorted.size(), lowest_y = 0;
+	for (int i = 1; i < n; i++) {
+		if ((sorted[i].y < sorted[lowest_y].y) || (sorted[i].y == sorted[lowest_y].y && sorted[i].x < sorted[lowest_y].x))
+			lowest_y = i;
+	}
+	ordered_vertices.clear();
+	if (n >= 3) {
+		std::swap(sorted[0], sorted[lowest_y]);
+		const vec3 p0 = sorted[0];
+		std::sort(sorted.begin() + 1, sorted.end(), [&p0](const vec3& p1, const vec3& p2) {
+			bool isLeft = is_leftturn(p0, p1, p2);
+			if (isLeft) {
+				return true;
+			}
+			else if (!is_leftturn(p0, p2, p1)) {
+				return square_dist(p0, p1) < square_dist(p0, p2);
+			}
+			return false;
+		});
+		ordered_vertices.push_back(sorted[0]);
+		ordered_vertices.push_back(sorted[1]);
+		ordered_vertices.push_back(sorted[2]);
+		for (int i = 3; i < n; i++) {
+			while (ordered_vertices.size() > 1 && !is_leftturn(*(ordered_vertices.end() - 2), ordered_vertices.back(), sorted[i]))
+				ordered_vertices.pop_back();
+			ordered_vertices.push_back(sorted[i]);
+		}
+	}
+
+	// shared edges of neighbouring triangles are tested once
+	edges.clear();
+	for (size_t i = 0; i + 2 < vertex_indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			uint16_t a = vertex_indices[i + k];
+			uint16_t b = vertex_indices[i + (k + 1) % 3];
+			edges.push_back({ std::min(a, b), std::max(a, b) });
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
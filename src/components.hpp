@@ -33,21 +33,22 @@ extern Statistic stats;
 
 // all purpose timer, create your own global timer
 struct UniversalTimer {
-	// Nearest enemy check timer
-	float closest_enemy_timer = 0;
-	float closest_enemy_timer_default = 500;
+	// Enemy closest to cursor, updated every frame from enemy_grid
 	int closest_enemy = -1;
 
 	// For aimbot1bullet, shoot a bullet per every aimbot_bullet_timer_default ms
 	float aimbot_bullet_timer = 0;
 	float aimbot_bullet_timer_default = 2000;
 
+	// Clock looping sprite animations play against, advanced by Animation::step so it stops outside of play
+	// Set back to 0 by WorldSystem on restart and next level, which moves EntityAnimation::start_ms along
+	float animation_ms = 0;
+
 	// Boss movement
 	float boss_can_move_timer = -1;
 	float boss_can_move_timer_default = 10000;
 
 	void restart() {
-		closest_enemy_timer = 0;
 		closest_enemy = -1;
 		aimbot_bullet_timer = 0;
 		boss_can_move_timer = -1;
@@ -493,6 +494,8 @@ struct Boss {
 	int current_bullet_phase_id = -1;
 	// between phase change time
 	float phase_change_time = -1;
+	// cleared bullets shrink away on phase change instead of vanishing
+	bool dissolve_bullets_on_phase_change = true;
 
 	// optional invisible entity for extra bullet spawner/pattern
 	// IMPORTANT: remember to remove this if removing this boss
@@ -539,8 +542,12 @@ enum VFX_TYPE {
 	AOE_AMMO_EXPLOSION,
 	AOE_AMMO_DISAPPEAR,
 	AIMBOT_AMMO_DISAPPEAR,
-	HIT_SPARK
+	HIT_SPARK,
+	BULLET_DISAPPEAR,
+	CRITICAL_HIT_ICON,
+	VFX_TYPE_COUNT
 };
+const int vfx_type_count = (int)VFX_TYPE_COUNT;
 
 struct IdleMoveAction {
 	State state = State::IDLE;
@@ -549,6 +556,10 @@ struct IdleMoveAction {
 	float moving_ms = 1500;
 };
 
+// Sprite sheet frame of an entity, frames are laid out left to right and rows picked by render_pos.y
+// Looping animations (animation, alwaysplayAni) are not advanced on the CPU: the frame is computed when drawn
+// from uni_timer.animation_ms, render_pos.x being the frame shown at start_ms. Set start_ms with render_pos.x.
+// playonceAni still advances render_pos.x every step.
 struct EntityAnimation {
 	State state = State::IDLE;
 	float frame_rate_ms = 200;
@@ -558,6 +569,16 @@ struct EntityAnimation {
 	bool isCursor = false;
 	float offset = 0;
 	bool is_active = true;
+	// uni_timer.animation_ms when render_pos.x was shown
+	float start_ms = 0;
+
+	int get_frame_count() const;
+	// Frames played up to time_ms counted from the first frame, without wrapping around
+	int get_played_frames(float time_ms) const;
+	// Frame shown at time_ms, render_pos.x's frame while inactive
+	int get_frame(float time_ms) const;
+	// render_pos of the frame shown at time_ms
+	vec2 get_end_pos(float time_ms) const;
 };
 
 struct DummyEnemySpawner {
@@ -824,11 +845,6 @@ struct Door {
 	Entity top_texture; // none if dir is UP OR DOWN
 };
 
-struct VisibilityTileInstanceData {
-	mat3 transform;
-	float alpha;
-};
-
 // All data relevant to the shape and motion of entities
 struct Motion {
 	vec2 position = { 0, 0 };
@@ -982,6 +998,18 @@ struct BulletDeathTimer
 	float death_counter_ms = -1;
 };
 
+// Batched dissolve effect of enemy bullets cleared at once (e.g. boss phase change)
+// One entity holds every cleared bullet instead of one disappear entity per bullet
+// Bullets shrink to nothing over max_counter_ms and are drawn in a single instanced draw
+struct BulletDissolve
+{
+	std::vector<vec2> positions;
+	std::vector<float> angles;
+	std::vector<vec2> scales;
+	float counter_ms = 300;
+	float max_counter_ms = 300;
+};
+
 struct InvulnerableTimer {
 	float invulnerable_counter_ms = 1000;
 };
@@ -1008,6 +1036,8 @@ struct RenderText {
 struct RenderTextPermanent {
 	std::string content;
 	float transparency = 1.0;
+	// HUD numbers, hidden during dialogue together with their icons
+	bool is_hud = false;
 };
 
 struct RenderTextWorld {
@@ -1024,10 +1054,15 @@ struct RenderTextPermanentWorld {
 struct Mesh
 {
 	static bool loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<uint16_t>& out_vertex_indices, vec2& out_size);
+	// Fills ordered_vertices and edges from vertices and vertex_indices
+	void computeCollisionData();
 	vec2 original_size = { 1,1 };
 	std::vector<ColoredVertex> vertices;
 	std::vector<uint16_t> vertex_indices;
+	// convex hull, counter-clockwise
 	std::vector<vec3> ordered_vertices;
+	// unique triangle edges as { lower vertex index, higher vertex index }, sorted
+	std::vector<std::pair<uint16_t, uint16_t>> edges;
 };
 
 // order is important, reflects keyboard.png
@@ -1260,16 +1295,43 @@ enum class GEOMETRY_BUFFER_ID {
 };
 const int geometry_count = (int)GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
+// Pass of RenderSystem::draw that draws a render request, in drawing order
+// Assigned at creation in world_init.cpp, the renderer does not check the entity's other components
+enum class RENDER_LAYER {
+	PARALLAX = 0,
+	ROOM_SIGNIFIER = PARALLAX + 1,
+	AURA = ROOM_SIGNIFIER + 1,
+	TELEPORTER = AURA + 1,
+	// camera culled and batched, e.g. enemies, items, walls and doors
+	WORLD = TELEPORTER + 1,
+	// UIUXWorld, e.g. tutorial keys
+	WORLD_UI = WORLD + 1,
+	PLAYER = WORLD_UI + 1,
+	PLAYER_BULLET = PLAYER + 1,
+	FOCUS_DOT = PLAYER_BULLET + 1,
+	AIMBOT_CURSOR = FOCUS_DOT + 1,
+	// UIUX, e.g. health and combo
+	UI = AIMBOT_CURSOR + 1,
+	BOSS_HEALTH_BAR = UI + 1,
+	DIALOGUE = BOSS_HEALTH_BAR + 1,
+	// main, pause, options, infographic, win and lose menus and their buttons
+	MENU = DIALOGUE + 1,
+	LAYER_COUNT = MENU + 1
+};
+
 struct RenderRequest {
 	TEXTURE_ASSET_ID used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
 	EFFECT_ASSET_ID used_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
 	GEOMETRY_BUFFER_ID used_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+	RENDER_LAYER layer = RENDER_LAYER::WORLD;
+	// drawing order of batched sprites within the layer, lower first, equal keys are batched by texture
+	int sort_key = 0;
 };
 
 // Struct for Font
 // This adapted from lecture material (Wednesday Feb 28th 2024)
 struct Character {
-	unsigned int TextureID;  // ID handle of the glyph texture
+	glm::vec4    UVRect;     // Glyph rectangle in the font atlas { u offset, v offset, u size, v size }
 	glm::ivec2   Size;       // Size of glyph
 	glm::ivec2   Bearing;    // Offset from baseline to left/top of glyph
 	unsigned int Advance;    // Offset to advance to next glyph
@@ -0,0 +1,94 @@
+#include "disk_cache.hpp"
+
+// stlib
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+uint64_t hash_bytes(const unsigned char* bytes, size_t size, uint64_t hash)
+{
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool read_file(const std::string& path, std::vector<unsigned char>& bytes)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return false;
+	std::streamsize size = file.tellg();
+	if (size < 0) return false;
+	file.seekg(0, std::ios::beg);
+	bytes.resize((size_t)size);
+	return size == 0 || (bool)file.read((char*)bytes.data(), size);
+}
+
+bool CacheReader::read_header(const char magic[4], uint32_t version)
+{
+	char file_magic[4];
+	uint32_t file_version;
+	return read(file_magic, sizeof(file_magic)) && memcmp(file_magic, magic, sizeof(file_magic)) == 0 &&
+		read(&file_version, sizeof(file_version)) && file_version == version;
+}
+
+bool CacheReader::read(void* destination, size_t size)
+{
+	const unsigned char* source = skip(size);
+	if (source == nullptr) return false;
+	memcpy(destination, source, size);
+	return true;
+}
+
+bool CacheReader::read_string(std::string& string)
+{
+	uint32_t length;
+	if (!read(&length, sizeof(length))) return false;
+	const unsigned char* characters = skip(length);
+	if (characters == nullptr) return false;
+	string.assign((const char*)characters, length);
+	return true;
+}
+
+const unsigned char* CacheReader::skip(size_t size)
+{
+	if (remaining() < size) return nullptr;
+	const unsigned char* position = file_data.data() + cursor;
+	cursor += size;
+	return position;
+}
+
+void write_string(std::ostream& file, const std::string& string)
+{
+	uint32_t length = (uint32_t)string.size();
+	file.write((const char*)&length, sizeof(length));
+	file.write(string.data(), length);
+}
+
+bool write_cache_file(const std::string& path, const char magic[4], uint32_t version,
+	const std::function<void(std::ostream&)>& write_body, const char* cache_name)
+{
+	const std::string temporary_path = path + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			fprintf(stderr, "Could not write %s %s\n", cache_name, temporary_path.c_str());
+			return false;
+		}
+		file.write(magic, 4);
+		file.write((const char*)&version, sizeof(version));
+		write_body(file);
+		if (!file) {
+			fprintf(stderr, "Could not write %s %s\n", cache_name, temporary_path.c_str());
+			return false;
+		}
+	}
+	// rename does not replace an existing file on every platform
+	std::remove(path.c_str());
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+		fprintf(stderr, "Could not write %s %s\n", cache_name, path.c_str());
+		return false;
+	}
+	return true;
+}
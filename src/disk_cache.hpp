@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Shared by the on-disk caches (TextureCache, MeshCache, ProgramCache)
+// A cache file starts with char magic[4] and uint32 version, followed by the layout of its cache.
+// Values are stored in native byte order as the files never leave the machine.
+
+const uint64_t HASH_BYTES_SEED = 14695981039346656037ull;
+
+// FNV-1a, fast enough to hash every source file on startup, continued from hash
+uint64_t hash_bytes(const unsigned char* bytes, size_t size, uint64_t hash = HASH_BYTES_SEED);
+inline uint64_t hash_bytes(const std::vector<unsigned char>& bytes, uint64_t hash = HASH_BYTES_SEED) { return hash_bytes(bytes.data(), bytes.size(), hash); }
+inline uint64_t hash_bytes(const std::string& bytes, uint64_t hash = HASH_BYTES_SEED) { return hash_bytes((const unsigned char*)bytes.data(), bytes.size(), hash); }
+
+// Reads the whole file at path, false if it can not be opened or read
+bool read_file(const std::string& path, std::vector<unsigned char>& bytes);
+
+// Bounds checked reads from a cache file loaded with read_file, a read past the end fails and reads nothing
+class CacheReader {
+	const std::vector<unsigned char>& file_data;
+	size_t cursor = 0;
+public:
+	explicit CacheReader(const std::vector<unsigned char>& file_data) : file_data(file_data) {}
+
+	// false unless the file starts with magic and version
+	bool read_header(const char magic[4], uint32_t version);
+	bool read(void* destination, size_t size);
+	// uint32 length followed by the characters
+	bool read_string(std::string& string);
+	// uint32 count followed by the elements
+	template <class T>
+	bool read_array(std::vector<T>& elements)
+	{
+		uint32_t count;
+		if (!read(&count, sizeof(count)) || remaining() / sizeof(T) < count) return false;
+		elements.resize(count);
+		return read(elements.data(), count * sizeof(T));
+	}
+	// Points at the next size bytes of the file and moves past them, nullptr if fewer are left
+	const unsigned char* skip(size_t size);
+	size_t remaining() const { return file_data.size() - cursor; }
+};
+
+// Counterparts of CacheReader::read_string and CacheReader::read_array
+void write_string(std::ostream& file, const std::string& string);
+template <class T>
+void write_array(std::ostream& file, const std::vector<T>& elements)
+{
+	uint32_t count = (uint32_t)elements.size();
+	file.write((const char*)&count, sizeof(count));
+	file.write((const char*)elements.data(), count * sizeof(T));
+}
+
+// Writes the header and then whatever write_body writes to the cache file at path
+// The file is only replaced once complete, so an interrupted save never leaves a truncated cache
+// Returns false after printing an error naming cache_name (e.g. "mesh cache") if writing fails
+bool write_cache_file(const std::string& path, const char magic[4], uint32_t version,
+	const std::function<void(std::ostream&)>& write_body, const char* cache_name);
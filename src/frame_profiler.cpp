@@ -0,0 +1,174 @@
+#include "frame_profiler.hpp"
+
+const char* render_pass_name(RENDER_PASS pass)
+{
+	switch (pass) {
+	case RENDER_PASS::PARALLAX: return "parallax";
+	case RENDER_PASS::TILES: return "tiles";
+	case RENDER_PASS::SPRITES: return "sprites";
+	case RENDER_PASS::BULLETS: return "bullets";
+	case RENDER_PASS::FOG: return "fog";
+	case RENDER_PASS::TEXT: return "text";
+	case RENDER_PASS::UI: return "ui";
+	case RENDER_PASS::TO_SCREEN: return "to_screen";
+	default: return "unknown";
+	}
+}
+
+FrameProfiler::FrameProfiler()
+{
+	cpu_ms.fill(0.f);
+	gpu_ms.fill(0.f);
+	window_cpu_ms.fill(0.f);
+	window_gpu_ms.fill(0.f);
+	for (PendingFrame& pending_frame : pending) {
+		pending_frame.cpu_ms.fill(0.f);
+	}
+}
+
+FrameProfiler::~FrameProfiler()
+{
+	if (csv_file != nullptr) {
+		fclose(csv_file);
+	}
+}
+
+void FrameProfiler::destroy()
+{
+	for (PendingFrame& pending_frame : pending) {
+		release(pending_frame);
+	}
+	if (!free_queries.empty()) {
+		glDeleteQueries((GLsizei)free_queries.size(), free_queries.data());
+		free_queries.clear();
+	}
+}
+
+bool FrameProfiler::open_csv(const std::string& path)
+{
+	if (csv_file != nullptr) {
+		fclose(csv_file);
+	}
+	csv_file = fopen(path.c_str(), "w");
+	if (csv_file == nullptr) {
+		fprintf(stderr, "Could not open %s\n", path.c_str());
+		return false;
+	}
+	fprintf(csv_file, "frame");
+	for (const char* unit : { "cpu", "gpu" }) {
+		for (int i = 0; i < pass_count; i++) {
+			fprintf(csv_file, ",%s_%s_ms", render_pass_name((RENDER_PASS)i), unit);
+		}
+	}
+	fprintf(csv_file, "\n");
+	return true;
+}
+
+void FrameProfiler::begin_frame(bool is_enabled)
+{
+	this->is_enabled = is_enabled || csv_file != nullptr;
+	if (!this->is_enabled) {
+		// results of an earlier enabled period would be averaged with the next one
+		for (PendingFrame& pending_frame : pending) {
+			release(pending_frame);
+		}
+		window_cpu_ms.fill(0.f);
+		window_gpu_ms.fill(0.f);
+		window_frames = 0;
+		return;
+	}
+
+	// this frame reuses the slot of the frame PROFILER_FRAMES frames back
+	PendingFrame& pending_frame = current();
+	if (!pending_frame.segments.empty()) {
+		resolve(pending_frame);
+	}
+	pending_frame.frame = frame;
+	pending_frame.cpu_ms.fill(0.f);
+}
+
+void FrameProfiler::begin(RENDER_PASS pass)
+{
+	if (!is_enabled) return;
+	end();
+
+	GLuint query;
+	if (free_queries.empty()) {
+		glGenQueries(1, &query);
+	}
+	else {
+		query = free_queries.back();
+		free_queries.pop_back();
+	}
+	// GL_TIME_ELAPSED queries can not nest, every segment gets its own
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	current().segments.push_back({ pass, query });
+	current_pass = pass;
+	is_in_pass = true;
+	pass_start = Clock::now();
+}
+
+void FrameProfiler::end()
+{
+	if (!is_in_pass) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	current().cpu_ms[(int)current_pass] += (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - pass_start)).count() / 1000;
+	is_in_pass = false;
+}
+
+void FrameProfiler::end_frame()
+{
+	end();
+	frame++;
+}
+
+void FrameProfiler::resolve(PendingFrame& pending_frame)
+{
+	// queries finish in order, if the last one is not done the frame is dropped rather than waited for
+	GLuint is_available = 0;
+	glGetQueryObjectuiv(pending_frame.segments.back().query, GL_QUERY_RESULT_AVAILABLE, &is_available);
+	if (is_available) {
+		std::array<float, pass_count> frame_gpu_ms;
+		frame_gpu_ms.fill(0.f);
+		for (Segment& segment : pending_frame.segments) {
+			GLuint64 elapsed_ns = 0;
+			glGetQueryObjectui64v(segment.query, GL_QUERY_RESULT, &elapsed_ns);
+			frame_gpu_ms[(int)segment.pass] += (float)elapsed_ns / 1000000;
+		}
+
+		for (int i = 0; i < pass_count; i++) {
+			window_cpu_ms[i] += pending_frame.cpu_ms[i];
+			window_gpu_ms[i] += frame_gpu_ms[i];
+		}
+		window_frames++;
+		if (window_frames == PROFILER_WINDOW_FRAMES) {
+			for (int i = 0; i < pass_count; i++) {
+				cpu_ms[i] = window_cpu_ms[i] / window_frames;
+				gpu_ms[i] = window_gpu_ms[i] / window_frames;
+			}
+			window_cpu_ms.fill(0.f);
+			window_gpu_ms.fill(0.f);
+			window_frames = 0;
+		}
+
+		if (csv_file != nullptr) {
+			fprintf(csv_file, "%d", pending_frame.frame);
+			for (int i = 0; i < pass_count; i++) {
+				fprintf(csv_file, ",%.3f", pending_frame.cpu_ms[i]);
+			}
+			for (int i = 0; i < pass_count; i++) {
+				fprintf(csv_file, ",%.3f", frame_gpu_ms[i]);
+			}
+			fprintf(csv_file, "\n");
+		}
+	}
+	release(pending_frame);
+}
+
+void FrameProfiler::release(PendingFrame& pending_frame)
+{
+	for (Segment& segment : pending_frame.segments) {
+		free_queries.push_back(segment.query);
+	}
+	pending_frame.segments.clear();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// Stages of RenderSystem::draw that are timed separately
+enum class RENDER_PASS {
+	PARALLAX = 0,
+	TILES = PARALLAX + 1,
+	SPRITES = TILES + 1,
+	BULLETS = SPRITES + 1,
+	FOG = BULLETS + 1,
+	TEXT = FOG + 1,
+	UI = TEXT + 1,
+	TO_SCREEN = UI + 1,
+	PASS_COUNT = TO_SCREEN + 1
+};
+const int pass_count = (int)RENDER_PASS::PASS_COUNT;
+
+const char* render_pass_name(RENDER_PASS pass);
+
+// Frames of GPU queries in flight, results are read this many frames late so the CPU never waits for them
+const int PROFILER_FRAMES = 3;
+// Frames averaged by the per-pass breakdown
+const int PROFILER_WINDOW_FRAMES = 60;
+
+// Times the passes of a frame on the CPU and on the GPU (GL_TIME_ELAPSED queries), e.g.
+//   profiler.begin_frame(is_enabled);
+//   profiler.begin(RENDER_PASS::TILES);
+//   drawTilesInstanced(...);
+//   profiler.begin(RENDER_PASS::SPRITES); // ends TILES
+//   ...
+//   profiler.end_frame();
+// A pass may be begun several times per frame, its segments are summed.
+// Time between end() and the next begin() is not counted.
+class FrameProfiler {
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Segment {
+		RENDER_PASS pass;
+		GLuint query;
+	};
+	// Queries and CPU times of a frame waiting for its GPU results
+	struct PendingFrame {
+		int frame = 0;
+		std::vector<Segment> segments;
+		std::array<float, pass_count> cpu_ms;
+	};
+
+	bool is_enabled = false;
+	bool is_in_pass = false;
+	RENDER_PASS current_pass = RENDER_PASS::PARALLAX;
+	Clock::time_point pass_start;
+	int frame = 0;
+	std::array<PendingFrame, PROFILER_FRAMES> pending;
+	std::vector<GLuint> free_queries;
+
+	// sums of the frames in the current window
+	std::array<float, pass_count> window_cpu_ms;
+	std::array<float, pass_count> window_gpu_ms;
+	int window_frames = 0;
+
+	FILE* csv_file = nullptr;
+
+	PendingFrame& current() { return pending[frame % PROFILER_FRAMES]; }
+	// Adds the results of pending_frame to the window if its queries are done, then frees its queries
+	void resolve(PendingFrame& pending_frame);
+	void release(PendingFrame& pending_frame);
+public:
+	// Mean milliseconds per frame over the last full window, per pass
+	std::array<float, pass_count> cpu_ms;
+	std::array<float, pass_count> gpu_ms;
+
+	FrameProfiler();
+	~FrameProfiler();
+	// Deletes the queries, call while the GL context is current
+	void destroy();
+
+	// Passes are only timed while enabled, e.g. while the overlay is shown or a csv is streamed
+	void begin_frame(bool is_enabled);
+	// Ends the current pass, if any, and starts timing pass
+	void begin(RENDER_PASS pass);
+	void end();
+	void end_frame();
+
+	// Writes one row per frame, milliseconds of every pass on the CPU then on the GPU
+	// Rows are written PROFILER_FRAMES frames late, once the GPU results are in
+	bool open_csv(const std::string& path);
+	bool is_streaming() { return csv_file != nullptr; }
+};
@@ -3,7 +3,10 @@
 #include <gl3w.h>
 
 // stlib
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <vector>
 
 // internal
 #include "physics_system.hpp"
@@ -20,9 +23,78 @@
 
 using Clock = std::chrono::high_resolution_clock;
 
+// Fixed step of the scripted scene, 60 Hz
+const float SCRIPTED_STEP_MS = 1000.f / 60.f;
+
 // Entry point
-int main()
+// Optional arguments:
+//   --seed <n>            seed all simulation randomness, so a run (e.g. a boss fight) can be replayed exactly
+//   --headless            render into an offscreen framebuffer without showing a window, runs the scripted scene
+//                         still needs an X display for the GL context, on a machine without one use Xvfb:
+//                         xvfb-run -s "-screen 0 1920x1080x24" ./twilightdungeon --headless
+//   --frames <n>          run n frames of the scripted scene and exit (600 with --headless):
+//                         a new game at level 1 without the opening dialogue, the player walking and firing,
+//                         see WorldSystem::scripted_input, stepped at a fixed 60 Hz, seed 427 unless --seed is given
+//   --frame-times <file>  write the update and draw time of every scripted frame as csv
+//   --render-scale <s>    render the scene at s (0.5 to 1) times the window resolution, see RenderSystem::set_render_scale
+//   --pass-times <file>   write the CPU and GPU time of every render pass of every frame as csv, see FrameProfiler
+//   --snapshot-dir <dir>  write every --snapshot-every <k>th (default 60) scripted frame to <dir>/frame_<n>.png,
+//                         the directory must exist
+int main(int argc, char* argv[])
 {
+	auto startup_start = Clock::now();
+	bool is_headless = false;
+	bool has_seed = false;
+	int scripted_frames = 0;
+	const char* frame_times_path = nullptr;
+	const char* pass_times_path = nullptr;
+	float render_scale = 1.f;
+	const char* snapshot_dir = nullptr;
+	int snapshot_every = 60;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			rng_service.set_seed((unsigned int)strtoul(argv[++i], nullptr, 10));
+			has_seed = true;
+		}
+		else if (strcmp(argv[i], "--headless") == 0) {
+			is_headless = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			scripted_frames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--frame-times") == 0 && i + 1 < argc) {
+			frame_times_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+			render_scale = (float)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--pass-times") == 0 && i + 1 < argc) {
+			pass_times_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "--snapshot-dir") == 0 && i + 1 < argc) {
+			snapshot_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--snapshot-every") == 0 && i + 1 < argc) {
+			snapshot_every = std::max(1, atoi(argv[++i]));
+		}
+	}
+	if (is_headless && scripted_frames == 0) {
+		scripted_frames = 600;
+	}
+	// scripted runs are reproducible so their snapshots can be diffed
+	if (scripted_frames > 0 && !has_seed) {
+		rng_service.set_seed(427);
+	}
+	// a machine without a GPU usually has no audio device either
+	if (is_headless) {
+		SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	}
+	printf("Random seed: %u\n", rng_service.get_seed());
+
+	// Worker threads, decode assets while the window and GL context are created, then build draw lists
+	// Declared first so it outlives the renderer
+	AssetLoader asset_loader;
+
 	// Global systems
 	WorldSystem world;
 	RenderSystem renderer;
@@ -37,8 +109,11 @@ int main()
 	// Global classes
 	Audio audio;
 
+	renderer.load_assets(asset_loader);
+	audio.load_assets(asset_loader);
+
 	// Initializing window
-	GLFWwindow* window = world.create_window();
+	GLFWwindow* window = world.create_window(is_headless);
 	if (!window) {
 		// Time to read the error message
 		printf("Press any key to exit");
@@ -48,7 +123,12 @@ int main()
 
 
 	// initialize the main systems
-	renderer.init(window);
+	renderer.init(window, is_headless);
+	renderer.set_render_scale(render_scale);
+	if (pass_times_path != nullptr) {
+		renderer.profiler.open_csv(pass_times_path);
+	}
+	audio.init();
 	world.init(&renderer, &audio, &map, &ai, &visibility_system, &boss_system);
 	bullets.init(&renderer, window, &audio);
 	ai.init(&visibility_system, &renderer);
@@ -58,19 +138,9 @@ int main()
 	world.init_options_menu();
 	visibility_system.init(&renderer);
 	physics.init(&renderer);
+	printf("Time to main menu: %.1f ms\n", (float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - startup_start)).count() / 1000);
 
-	// variable timestep loop
-	auto t = Clock::now();
-	while (!world.is_over()) {
-		// Processes system messages, if this wasn't present the window would become unresponsive
-		glfwPollEvents();
-
-		// Calculating elapsed times in milliseconds from the previous iteration
-		auto now = Clock::now();
-		float elapsed_ms =
-			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
-		t = now;
-
+	auto step = [&](float elapsed_ms) {
 		audio.step(elapsed_ms);
 
 		if (menu.state == MENU_STATE::MAIN_MENU || menu.state == MENU_STATE::OPTIONS) {
@@ -97,6 +167,78 @@ int main()
 		else if (menu.state == MENU_STATE::DIALOGUE) {
 			world.dialogue_step(elapsed_ms);
 		}
+	};
+
+	if (scripted_frames > 0) {
+		// frame times should not be capped by vsync
+		glfwSwapInterval(0);
+		world.new_scripted_game();
+
+		FILE* frame_times_file = nullptr;
+		if (frame_times_path != nullptr) {
+			frame_times_file = fopen(frame_times_path, "w");
+			if (frame_times_file == nullptr) {
+				fprintf(stderr, "Could not open %s\n", frame_times_path);
+			}
+			else {
+				fprintf(frame_times_file, "frame,update_ms,draw_ms,draw_calls,sprites_considered,sprites_drawn\n");
+			}
+		}
+
+		std::vector<float> frame_ms;
+		for (int frame = 0; frame < scripted_frames && !world.is_over(); frame++) {
+			glfwPollEvents();
+			world.scripted_input(frame);
+
+			auto update_start = Clock::now();
+			step(SCRIPTED_STEP_MS);
+
+			auto draw_start = Clock::now();
+			if (snapshot_dir != nullptr && frame % snapshot_every == 0) {
+				char name[32];
+				snprintf(name, sizeof(name), "/frame_%05d.png", frame);
+				renderer.request_snapshot(std::string(snapshot_dir) + name);
+			}
+			renderer.draw();
+			// wait for the frame to be rendered so the draw time includes the GPU (or software rasterizer)
+			glFinish();
+			auto draw_end = Clock::now();
+
+			float update_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(draw_start - update_start)).count() / 1000;
+			float draw_ms = (float)(std::chrono::duration_cast<std::chrono::microseconds>(draw_end - draw_start)).count() / 1000;
+			frame_ms.push_back(update_ms + draw_ms);
+			if (frame_times_file != nullptr) {
+				fprintf(frame_times_file, "%d,%.3f,%.3f,%d,%d,%d\n", frame, update_ms, draw_ms, renderer.get_draw_calls(),
+					renderer.get_sprites_considered(), renderer.get_sprites_drawn());
+			}
+		}
+		if (frame_times_file != nullptr) {
+			fclose(frame_times_file);
+		}
+
+		if (frame_ms.size() > 0) {
+			float total_ms = 0;
+			for (float ms : frame_ms) total_ms += ms;
+			std::sort(frame_ms.begin(), frame_ms.end());
+			printf("Scripted scene: %zu frames, mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", frame_ms.size(), total_ms / frame_ms.size(),
+				frame_ms[frame_ms.size() / 2], frame_ms[std::min(frame_ms.size() - 1, frame_ms.size() * 99 / 100)], frame_ms.back());
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// variable timestep loop
+	auto t = Clock::now();
+	while (!world.is_over()) {
+		// Processes system messages, if this wasn't present the window would become unresponsive
+		glfwPollEvents();
+
+		// Calculating elapsed times in milliseconds from the previous iteration
+		auto now = Clock::now();
+		float elapsed_ms =
+			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
+		t = now;
+
+		step(elapsed_ms);
 
 		renderer.draw();
 	}
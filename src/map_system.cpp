@@ -10,8 +10,6 @@
 int room_size = 11; // Must be at least >= 4
 
 MapSystem::MapSystem() {
-	// Seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
 }
 
 void MapSystem::init(RenderSystem* renderer_arg, VisibilitySystem* visibility_arg) {
@@ -279,8 +277,7 @@ void MapSystem::spawnEnemiesInRoom(Room_struct& room)
 		createTreasure(renderer, convert_grid_to_world((room.top_left + room.bottom_right) / 2.f + vec2(0.f, 2 * 1.f)));
 
 		// Choose an ammo that is currently not used
-		std::random_device rd;
-		std::mt19937 gen(rd());
+		std::mt19937& gen = rng_service.get(RNG_STREAM::MAP);
 		std::uniform_real_distribution<> distrib(0, 1);
 		// X chance to spawn an ammo
 		if (distrib(gen) < 1.4) {
@@ -641,8 +638,7 @@ void MapSystem::generateRandomMap(float room_size) {
 	// Generate special obstacles for specific levels
 	if (map_info.level == MAP_LEVEL::LEVEL4) {
 		Room_struct& boss_room = bsptree.rooms[bsptree.rooms.size() - 1];
-		std::random_device ran;
-		std::mt19937 gen(ran());
+		std::mt19937& gen = rng_service.get(RNG_STREAM::MAP);
 		std::uniform_real_distribution<float> dis(0, 1);
 		createPillar(renderer, boss_room.top_left + vec2(2, 2), dis(gen) < 0.5f);
 		createPillar(renderer, boss_room.bottom_right - vec2(2, 2), dis(gen) < 0.5f);
@@ -651,8 +647,7 @@ void MapSystem::generateRandomMap(float room_size) {
 	}
 	else if (map_info.level == MAP_LEVEL::LEVEL3) {
 		Room_struct& boss_room = bsptree.rooms[bsptree.rooms.size() - 1];
-		std::random_device ran;
-		std::mt19937 gen(ran());
+		std::mt19937& gen = rng_service.get(RNG_STREAM::MAP);
 		std::uniform_int_distribution<> dis(2, 3);
 
 		auto createObstacleInRoom = [&](vec2 position, bool x_add, bool y_add) {
@@ -682,8 +677,8 @@ void MapSystem::generateRandomMap(float room_size) {
 		visibility_system->init_visibility();
 	}
 
-	// set buffer data for visibility tile instance rendering
-	renderer->set_visibility_tiles_instance_buffer_max();
+	// set fog texture for visibility rendering
+	renderer->set_fog_texture(visibility_system->fog_map.data(), ivec2(WORLD_WIDTH_DEFAULT, WORLD_HEIGHT_DEFAULT));
 	// set buffer data for tile instance rendering
 	renderer->set_tiles_instance_buffer();
 
@@ -949,8 +944,7 @@ TILE_NAME MapSystem::get_tile_name(int x, int y, std::vector<std::vector<int>>&
 			temp = TILE_NAME::FLOOR_1_0;
 			break;
 		case MAP_LEVEL::LEVEL2: {
-			std::random_device ran;
-			std::mt19937 gen(ran());
+			std::mt19937& gen = rng_service.get(RNG_STREAM::MAP);
 			std::uniform_real_distribution<> dis(0.f, 1.f);
 			float random_number = dis(gen);
 			if (random_number < 0.7f) {
@@ -974,8 +968,7 @@ TILE_NAME MapSystem::get_tile_name(int x, int y, std::vector<std::vector<int>>&
 			break;
 		}
 		case MAP_LEVEL::LEVEL3: {
-			std::random_device ran;
-			std::mt19937 gen(ran());
+			std::mt19937& gen = rng_service.get(RNG_STREAM::MAP);
 			std::uniform_real_distribution<> dis(0.f, 1.f);
 			float random_number = dis(gen);
 			if (random_number < 0.5f) {
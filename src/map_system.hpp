@@ -38,8 +38,8 @@ private:
 
 	void generate_all_tiles(std::vector<std::vector<int>>& map);
 
-	// C++ random number generator
-	std::default_random_engine rng;
+	// C++ random number generator, drawn from the seedable MAP substream
+	std::mt19937& rng = rng_service.get(RNG_STREAM::MAP);
 	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 
 	// Binary space partitioning tree
@@ -0,0 +1,110 @@
+#include "mesh_cache.hpp"
+#include "disk_cache.hpp"
+
+// Cache file layout after the disk cache header:
+//   uint32 entry_count
+//   per entry: uint32 path_length, char path[path_length], uint64 source_hash, vec2 original_size,
+//              uint32 vertex_count, ColoredVertex vertices[vertex_count],
+//              uint32 index_count, uint16 vertex_indices[index_count],
+//              uint32 hull_count, vec3 ordered_vertices[hull_count],
+//              uint32 edge_count, uint16 edges[edge_count][2]
+static const char MESH_CACHE_MAGIC[4] = { 'T', 'D', 'M', 'C' };
+// bump when the layout, the OBJ parser or the collision data changes
+static const uint32_t MESH_CACHE_VERSION = 1;
+
+void MeshCache::load(const std::string& cache_path)
+{
+	clear();
+	this->cache_path = cache_path;
+	// the whole file is read at once, entries are copied straight out of it
+	std::vector<unsigned char> file_data;
+	if (!read_file(cache_path, file_data)) return;
+
+	CacheReader reader(file_data);
+	uint32_t entry_count;
+	if (!reader.read_header(MESH_CACHE_MAGIC, MESH_CACHE_VERSION) || !reader.read(&entry_count, sizeof(entry_count))) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < entry_count; i++) {
+		std::string path;
+		Entry entry;
+		Mesh& mesh = entry.mesh;
+		if (!reader.read_string(path) || !reader.read(&entry.source_hash, sizeof(entry.source_hash)) ||
+			!reader.read(&mesh.original_size, sizeof(mesh.original_size)) || !reader.read_array(mesh.vertices) ||
+			!reader.read_array(mesh.vertex_indices) || !reader.read_array(mesh.ordered_vertices) || !reader.read_array(mesh.edges)) {
+			clear();
+			return;
+		}
+		entry.is_loaded = true;
+		entries[path] = std::move(entry);
+	}
+}
+
+bool MeshCache::get(const std::string& path, Mesh& mesh)
+{
+	// the source file is read anyway to check the hash
+	std::vector<unsigned char> source;
+	if (!read_file(path, source)) return false;
+	uint64_t source_hash = hash_bytes(source);
+
+	{
+		std::lock_guard<std::mutex> lock(entries_mutex);
+		Entry& entry = entries[path];
+		entry.is_used = true;
+		if (entry.is_loaded && entry.source_hash == source_hash) {
+			hits++;
+			mesh = entry.mesh;
+			return true;
+		}
+	}
+
+	// parsed without holding the lock, entries of other paths are not touched
+	Mesh parsed;
+	if (!Mesh::loadFromOBJFile(path, parsed.vertices, parsed.vertex_indices, parsed.original_size)) return false;
+	parsed.computeCollisionData();
+
+	std::lock_guard<std::mutex> lock(entries_mutex);
+	Entry& entry = entries[path];
+	misses++;
+	entry.source_hash = source_hash;
+	entry.mesh = parsed;
+	entry.is_loaded = true;
+	is_dirty = true;
+
+	mesh = std::move(parsed);
+	return true;
+}
+
+void MeshCache::save()
+{
+	if (!is_dirty || cache_path.empty()) return;
+
+	bool is_written = write_cache_file(cache_path, MESH_CACHE_MAGIC, MESH_CACHE_VERSION, [this](std::ostream& file) {
+		uint32_t entry_count = 0;
+		for (auto& pair : entries) {
+			if (pair.second.is_used && pair.second.is_loaded) entry_count++;
+		}
+		file.write((const char*)&entry_count, sizeof(entry_count));
+		for (auto& pair : entries) {
+			const Entry& entry = pair.second;
+			if (!entry.is_used || !entry.is_loaded) continue;
+			write_string(file, pair.first);
+			file.write((const char*)&entry.source_hash, sizeof(entry.source_hash));
+			file.write((const char*)&entry.mesh.original_size, sizeof(entry.mesh.original_size));
+			write_array(file, entry.mesh.vertices);
+			write_array(file, entry.mesh.vertex_indices);
+			write_array(file, entry.mesh.ordered_vertices);
+			write_array(file, entry.mesh.edges);
+		}
+	}, "mesh cache");
+	if (is_written) is_dirty = false;
+}
+
+void MeshCache::clear()
+{
+	entries.clear();
+	is_dirty = false;
+	hits = 0;
+	misses = 0;
+}
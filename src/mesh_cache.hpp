@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// On-disk cache of parsed OBJ meshes with their collision data, so later launches skip parsing, e.g.
+//   mesh_cache.load(mesh_cache_path());
+//   bool is_loaded = mesh_cache.get(path, mesh);
+//   mesh_cache.save();
+// Entries are keyed by OBJ path and are stale once the hash of the source file changes.
+// Besides vertices and indices an entry holds Mesh::ordered_vertices and Mesh::edges.
+class MeshCache {
+	struct Entry {
+		uint64_t source_hash = 0;
+		Mesh mesh;
+		bool is_loaded = false;
+		// requested since load, only those are written by save
+		bool is_used = false;
+	};
+
+	std::string cache_path;
+	std::unordered_map<std::string, Entry> entries;
+	bool is_dirty = false;
+	// get is called from AssetLoader workers
+	std::mutex entries_mutex;
+public:
+	// Number of meshes served from the cache and parsed from their source file since load
+	int hits = 0;
+	int misses = 0;
+
+	// Reads the cache file, a missing, outdated or malformed file leaves the cache empty
+	void load(const std::string& cache_path);
+	// Fills mesh with the OBJ at path, including its collision data, false if it can not be loaded
+	// Stale or missing entries are parsed and replace the entry
+	// Thread safe, meshes are loaded in parallel
+	bool get(const std::string& path, Mesh& mesh);
+	// Writes the used entries back to the cache file if any were parsed
+	void save();
+	void clear();
+};
+
+inline std::string mesh_cache_path() { return data_path() + "/mesh_cache.bin"; }
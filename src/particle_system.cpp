@@ -0,0 +1,99 @@
+#include "particle_system.hpp"
+
+ParticleSystem particles;
+
+// indexed by VFX_TYPE
+static const std::array<ParticleEffect, vfx_type_count> PARTICLE_EFFECTS = { {
+	{ TEXTURE_ASSET_ID::AOE_AMMO_EXPLOSION, 82, 1000.f / 60.f, { 0, 0 } },
+	{ TEXTURE_ASSET_ID::AOE_AMMO_BULLET_DISAPPEAR, 4, 1000.f / 10.f, { 0, 0 } },
+	{ TEXTURE_ASSET_ID::AIMBOT_AMMO_BULLET_DISAPPEAR, 4, 1000.f / 10.f, { 0, 0 } },
+	{ TEXTURE_ASSET_ID::HIT_SPARK, 7, 1000.f / 10.f, { 0, 0 } },
+	{ TEXTURE_ASSET_ID::REIMU_BULLET_DISAPPEAR, 4, 50.f, { 0, 0 } },
+	// a single frame floating up for 300 ms
+	{ TEXTURE_ASSET_ID::CRTHITICON, 1, 300.f, { 0, -300 } },
+} };
+
+// same factor as the velocity interpolation of PhysicsSystem
+const float PARTICLE_DAMPING = 10.f;
+
+const ParticleEffect& particle_effect(VFX_TYPE type)
+{
+	return PARTICLE_EFFECTS[type];
+}
+
+ParticleSystem::ParticleSystem()
+{
+	for (Pool& pool : pools) {
+		pool.positions.resize(PARTICLE_POOL_CAPACITY);
+		pool.velocities.resize(PARTICLE_POOL_CAPACITY);
+		pool.scales.resize(PARTICLE_POOL_CAPACITY);
+		pool.angles.resize(PARTICLE_POOL_CAPACITY);
+		pool.frames.resize(PARTICLE_POOL_CAPACITY);
+		pool.frame_timers_ms.resize(PARTICLE_POOL_CAPACITY);
+	}
+}
+
+void ParticleSystem::spawn(VFX_TYPE type, vec2 position, vec2 scale, float angle)
+{
+	Pool& pool = pools[type];
+	if (pool.count == PARTICLE_POOL_CAPACITY) return;
+	const ParticleEffect& effect = PARTICLE_EFFECTS[type];
+	int i = pool.count++;
+	pool.positions[i] = position;
+	pool.velocities[i] = effect.initial_velocity;
+	pool.scales[i] = scale;
+	pool.angles[i] = angle;
+	pool.frames[i] = 0;
+	pool.frame_timers_ms[i] = effect.frame_ms;
+}
+
+void ParticleSystem::step(float elapsed_ms)
+{
+	float step_seconds = elapsed_ms / 1000.f;
+	for (int type = 0; type < vfx_type_count; type++) {
+		Pool& pool = pools[type];
+		const ParticleEffect& effect = PARTICLE_EFFECTS[type];
+		bool is_moving = effect.initial_velocity != vec2(0);
+		// backwards, remove moves the last particle into the current index
+		for (int i = pool.count - 1; i >= 0; i--) {
+			if (is_moving) {
+				pool.velocities[i] = vec2_lerp(pool.velocities[i], vec2(0), step_seconds * PARTICLE_DAMPING);
+				pool.positions[i] += pool.velocities[i] * step_seconds;
+			}
+			pool.frame_timers_ms[i] -= elapsed_ms;
+			if (pool.frame_timers_ms[i] < 0) {
+				pool.frame_timers_ms[i] = effect.frame_ms;
+				if (++pool.frames[i] == effect.frame_count) {
+					remove(pool, i);
+				}
+			}
+		}
+	}
+}
+
+void ParticleSystem::clear()
+{
+	for (Pool& pool : pools) {
+		pool.count = 0;
+	}
+}
+
+int ParticleSystem::size() const
+{
+	int size = 0;
+	for (const Pool& pool : pools) {
+		size += pool.count;
+	}
+	return size;
+}
+
+void ParticleSystem::remove(Pool& pool, int index)
+{
+	int last = --pool.count;
+	pool.positions[index] = pool.positions[last];
+	pool.velocities[index] = pool.velocities[last];
+	pool.scales[index] = pool.scales[last];
+	pool.angles[index] = pool.angles[last];
+	pool.frames[index] = pool.frames[last];
+	pool.frame_timers_ms[index] = pool.frame_timers_ms[last];
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Most live particles of one VFX_TYPE, spawns into a full pool are dropped
+const int PARTICLE_POOL_CAPACITY = 1024;
+
+// How a VFX_TYPE looks and moves, every effect plays its sprite sheet once and then disappears
+struct ParticleEffect {
+	TEXTURE_ASSET_ID texture;
+	// frames laid out left to right in the texture
+	int frame_count;
+	float frame_ms;
+	// pixels per second at spawn, slowed down like a Kinematic without speed
+	vec2 initial_velocity;
+};
+
+const ParticleEffect& particle_effect(VFX_TYPE type);
+
+// Short lived sprite sheet effects, e.g. hit sparks, explosions and bullet disappears, kept outside the registry
+//   particles.spawn(VFX_TYPE::HIT_SPARK, position, scale, angle);
+//   particles.step(elapsed_ms); // advances frames, removes finished particles
+// RenderSystem batches every live particle with the world sprites, one instanced draw per texture or atlas page
+class ParticleSystem {
+public:
+	// Parallel arrays, the first count entries are live
+	struct Pool {
+		int count = 0;
+		std::vector<vec2> positions;
+		std::vector<vec2> velocities;
+		std::vector<vec2> scales;
+		std::vector<float> angles;
+		std::vector<int> frames;
+		std::vector<float> frame_timers_ms;
+	};
+
+	ParticleSystem();
+
+	void spawn(VFX_TYPE type, vec2 position, vec2 scale, float angle);
+	void step(float elapsed_ms);
+	// Removes every particle, e.g. when the level is left
+	void clear();
+
+	const Pool& pool(VFX_TYPE type) const { return pools[type]; }
+	int size() const;
+private:
+	std::array<Pool, vfx_type_count> pools;
+
+	// Moves the last live particle into index
+	void remove(Pool& pool, int index);
+};
+
+extern ParticleSystem particles;
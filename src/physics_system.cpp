@@ -160,7 +160,6 @@ bool collides_mesh_AABB(const Entity& e1, const Motion& motion1, const Motion& m
 		{left2, bottom2, 0}, {right2, bottom2, 0}, {right2, top2, 0}, {left2, top2, 0}
 	};
 	// Checking if vertices of AABB are colliding with mesh
-	std::set<std::pair<uint16_t, uint16_t>> mesh_edges;
 	vec3 v1;
 	vec3 v2;
 	vec3 v3;
@@ -180,14 +179,11 @@ bool collides_mesh_AABB(const Entity& e1, const Motion& motion1, const Motion& m
 		for (vec3 box_vertex : box_vertices) {
 			if (in_triangle(box_vertex, transformed_v1, transformed_v2, transformed_v3)) return true;
 		}
-		mesh_edges.insert({ std::min(vid_1, vid_2), std::max(vid_1, vid_2) });
-		mesh_edges.insert({ std::min(vid_2, vid_3), std::max(vid_2, vid_3) });
-		mesh_edges.insert({ std::min(vid_3, vid_1), std::max(vid_3, vid_1) });
 	}
 
 
-	// Checking if edges of AABB and mesh are colliding
-	for (const auto& meshEdge : mesh_edges) {
+	// Checking if edges of AABB and mesh are colliding, the unique edges are precomputed with the mesh
+	for (const auto& meshEdge : e1_mesh->edges) {
 		for (const auto& boxEdge : box_edges) {
 			v1 = e1_mesh->vertices[meshEdge.first].position;
 			v2 = e1_mesh->vertices[meshEdge.second].position;
@@ -332,17 +328,17 @@ void PhysicsSystem::step(float elapsed_ms)
 
 		if (!is_valid_cell_physics(grid_coord.x, grid_coord.y)) {
 			if (registry.normalBullets.has(entity)) {
-				registry.realDeathTimers.emplace(createBulletDisappear(renderer, motion.position, motion.angle, true)).death_counter_ms = 200;
+				createBulletDisappear(motion.position, motion.angle);
 			}
 			else if (registry.aoeBullets.has(entity)) {
-				createVFX(renderer, motion.position, motion.scale, 0, VFX_TYPE::AOE_AMMO_DISAPPEAR);
+				createVFX(motion.position, motion.scale, 0, VFX_TYPE::AOE_AMMO_DISAPPEAR);
 			}
 			else if (registry.aimbotBullets.has(entity)) {
 				Kinematic& kin = registry.kinematics.get(entity);
 				Transform t;
 				t.rotate(-45.f * M_PI / 180.f);
 				kin.direction = t.mat * vec3(kin.direction, 1.f);
-				createVFX(renderer, motion.position, motion.scale, -atan2(kin.direction.x, kin.direction.y) - glm::radians(90.0f), VFX_TYPE::AIMBOT_AMMO_DISAPPEAR);
+				createVFX(motion.position, motion.scale, -atan2(kin.direction.x, kin.direction.y) - glm::radians(90.0f), VFX_TYPE::AIMBOT_AMMO_DISAPPEAR);
 			}
 			registry.remove_all_components_of(entity);
 		}
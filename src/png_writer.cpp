@@ -0,0 +1,95 @@
+#include "png_writer.hpp"
+
+// stlib
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+// CRC-32 of PNG chunks, table built on first use
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+	static uint32_t table[256] = { 0 };
+	if (table[1] == 0) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) {
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void append_u32(std::vector<unsigned char>& out, uint32_t value)
+{
+	out.push_back((value >> 24) & 0xFF);
+	out.push_back((value >> 16) & 0xFF);
+	out.push_back((value >> 8) & 0xFF);
+	out.push_back(value & 0xFF);
+}
+
+static void append_chunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+	append_u32(out, (uint32_t)data.size());
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	append_u32(out, crc32(out.data() + start, out.size() - start));
+}
+
+bool write_png(const std::string& path, int width, int height, const unsigned char* rgba)
+{
+	// filter type 0 (none) before every row
+	const size_t row_size = (size_t)width * 4;
+	std::vector<unsigned char> raw;
+	raw.reserve((row_size + 1) * height);
+	for (int y = 0; y < height; y++) {
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba + y * row_size, rgba + (y + 1) * row_size);
+	}
+
+	// zlib stream of stored blocks, each at most 65535 bytes
+	std::vector<unsigned char> zlib = { 0x78, 0x01 };
+	const size_t MAX_BLOCK_SIZE = 65535;
+	size_t offset = 0;
+	do {
+		size_t block_size = std::min(MAX_BLOCK_SIZE, raw.size() - offset);
+		bool is_last = offset + block_size == raw.size();
+		zlib.push_back(is_last ? 1 : 0);
+		zlib.push_back(block_size & 0xFF);
+		zlib.push_back((block_size >> 8) & 0xFF);
+		zlib.push_back(~block_size & 0xFF);
+		zlib.push_back((~block_size >> 8) & 0xFF);
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block_size);
+		offset += block_size;
+	} while (offset < raw.size());
+	// Adler-32 of the uncompressed data
+	uint32_t a = 1, b = 0;
+	for (unsigned char byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	append_u32(zlib, (b << 16) | a);
+
+	std::vector<unsigned char> header;
+	append_u32(header, (uint32_t)width);
+	append_u32(header, (uint32_t)height);
+	// 8 bit depth, RGBA colour, default compression, filter and no interlace
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+	std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	append_chunk(png, "IHDR", header);
+	append_chunk(png, "IDAT", zlib);
+	append_chunk(png, "IEND", {});
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return false;
+	file.write((const char*)png.data(), png.size());
+	return (bool)file;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Writes width x height RGBA8 pixels, rows top to bottom, as an uncompressed PNG
+// Uses stored deflate blocks so no compression library is needed, returns false if the file can not be written
+bool write_png(const std::string& path, int width, int height, const unsigned char* rgba);
@@ -0,0 +1,151 @@
+#include "program_cache.hpp"
+#include "disk_cache.hpp"
+
+// stlib
+#include <algorithm>
+
+// Cache file layout after the disk cache header:
+//   uint32 driver_length, char driver[driver_length], uint32 entry_count
+//   per entry: uint64 key, uint32 format, uint32 binary_length, unsigned char binary[binary_length]
+static const char PROGRAM_CACHE_MAGIC[4] = { 'T', 'D', 'P', 'C' };
+// bump when the layout changes
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+uint64_t hash_program_sources(const std::string& vs_source, const std::string& fs_source)
+{
+	// GLSL never contains a null character, it separates the sources so "ab" + "c" and "a" + "bc" differ
+	return hash_bytes(fs_source, hash_bytes(vs_source + '\0'));
+}
+
+static std::string gl_string(GLenum name)
+{
+	const char* value = (const char*)glGetString(name);
+	return value != nullptr ? value : "";
+}
+
+void ProgramCache::load(const std::string& cache_path)
+{
+	clear();
+	this->cache_path = cache_path;
+
+	// glGetProgramBinary is core in OpenGL 4.1 and otherwise ARB_get_program_binary
+	formats.clear();
+	if (glGetProgramBinary != nullptr && glProgramBinary != nullptr) {
+		GLint format_count = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+		if (format_count > 0) {
+			formats.resize(format_count);
+			glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+		}
+	}
+	gl_has_errors();
+	if (!is_supported()) return;
+	driver = gl_string(GL_VENDOR) + "\n" + gl_string(GL_RENDERER) + "\n" + gl_string(GL_VERSION);
+
+	std::vector<unsigned char> file_data;
+	if (!read_file(cache_path, file_data)) return;
+
+	CacheReader reader(file_data);
+	std::string file_driver;
+	uint32_t entry_count;
+	if (!reader.read_header(PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION) || !reader.read_string(file_driver)) return;
+	// a driver update may change the binary format without changing its enum
+	if (file_driver != driver) return;
+	if (!reader.read(&entry_count, sizeof(entry_count))) return;
+
+	for (uint32_t i = 0; i < entry_count; i++) {
+		uint64_t key;
+		uint32_t format;
+		std::vector<unsigned char> binary;
+		if (!reader.read(&key, sizeof(key)) || !reader.read(&format, sizeof(format)) || !reader.read_array(binary)) {
+			entries.clear();
+			return;
+		}
+		Entry& entry = entries[key];
+		entry.format = format;
+		entry.binary = std::move(binary);
+	}
+}
+
+bool ProgramCache::get(uint64_t key, GLuint program)
+{
+	auto found = entries.find(key);
+	if (found == entries.end()) return false;
+	Entry& entry = found->second;
+	// an unknown format would raise GL_INVALID_ENUM instead of just failing to link
+	if (std::find(formats.begin(), formats.end(), (GLint)entry.format) == formats.end()) {
+		entries.erase(found);
+		return false;
+	}
+
+	glProgramBinary(program, entry.format, entry.binary.data(), (GLsizei)entry.binary.size());
+	GLint is_linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+	gl_has_errors();
+	if (is_linked == GL_FALSE) {
+		// rejected binaries are recompiled and replaced by put
+		entries.erase(found);
+		return false;
+	}
+	entry.is_used = true;
+	hits++;
+	return true;
+}
+
+void ProgramCache::prepare(GLuint program)
+{
+	if (!is_supported()) return;
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	gl_has_errors();
+}
+
+void ProgramCache::put(uint64_t key, GLuint program)
+{
+	misses++;
+	if (!is_supported()) return;
+
+	GLint binary_length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+	if (binary_length <= 0) return;
+	Entry entry;
+	entry.binary.resize(binary_length);
+	GLsizei written = 0;
+	glGetProgramBinary(program, binary_length, &written, &entry.format, entry.binary.data());
+	gl_has_errors();
+	if (written <= 0) return;
+	entry.binary.resize(written);
+	entry.is_used = true;
+	entries[key] = std::move(entry);
+	is_dirty = true;
+}
+
+void ProgramCache::save()
+{
+	if (!is_dirty || cache_path.empty()) return;
+
+	bool is_written = write_cache_file(cache_path, PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, [this](std::ostream& file) {
+		uint32_t entry_count = 0;
+		for (auto& pair : entries) {
+			if (pair.second.is_used) entry_count++;
+		}
+		write_string(file, driver);
+		file.write((const char*)&entry_count, sizeof(entry_count));
+		for (auto& pair : entries) {
+			const Entry& entry = pair.second;
+			if (!entry.is_used) continue;
+			uint32_t format = entry.format;
+			file.write((const char*)&pair.first, sizeof(pair.first));
+			file.write((const char*)&format, sizeof(format));
+			write_array(file, entry.binary);
+		}
+	}, "program cache");
+	if (is_written) is_dirty = false;
+}
+
+void ProgramCache::clear()
+{
+	entries.clear();
+	is_dirty = false;
+	hits = 0;
+	misses = 0;
+}
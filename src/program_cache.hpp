@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+
+// On-disk cache of linked shader programs (glGetProgramBinary), so later launches skip compiling GLSL, e.g.
+//   program_cache.load(program_cache_path());
+//   uint64_t key = hash_program_sources(vs_source, fs_source);
+//   if (!program_cache.get(key, program)) { ...compile and link program...; program_cache.put(key, program); }
+//   program_cache.save();
+// Entries are keyed by the hash of the shader sources, the whole cache is dropped when the driver changes.
+// Without program binary support (GL_NUM_PROGRAM_BINARY_FORMATS == 0) get always misses and nothing is written.
+class ProgramCache {
+	struct Entry {
+		GLenum format = 0;
+		std::vector<unsigned char> binary;
+		// requested or stored since load, only those are written by save
+		bool is_used = false;
+	};
+
+	std::string cache_path;
+	// vendor, renderer and version strings, binaries only load on the driver that produced them
+	std::string driver;
+	std::vector<GLint> formats;
+	std::unordered_map<uint64_t, Entry> entries;
+	bool is_dirty = false;
+public:
+	// Number of programs loaded from binaries and compiled from source since load
+	int hits = 0;
+	int misses = 0;
+
+	// Reads the cache file, call while the GL context is current
+	// A missing, outdated or malformed file, or one written by another driver, leaves the cache empty
+	void load(const std::string& cache_path);
+	bool is_supported() const { return !formats.empty(); }
+	// Loads the binary cached under key into program, false if there is none or the driver rejects it
+	// A program that failed to load is left unlinked and should be deleted
+	bool get(uint64_t key, GLuint program);
+	// Call before linking a program that will be put, some drivers only keep binaries of hinted programs
+	void prepare(GLuint program);
+	// Stores the binary of the linked program under key
+	void put(uint64_t key, GLuint program);
+	// Writes the used entries back to the cache file if any were added
+	void save();
+	void clear();
+};
+
+// Key of a program, changes whenever either source changes
+uint64_t hash_program_sources(const std::string& vs_source, const std::string& fs_source);
+
+inline std::string program_cache_path() { return data_path() + "/program_cache.bin"; }
@@ -1,8 +1,159 @@
 // internal
 #include "render_system.hpp"
 #include "world_system.hpp"
+#include "png_writer.hpp"
+#include "particle_system.hpp"
 #include <SDL.h>
 
+void GLStateCache::begin_frame()
+{
+	calls = 0;
+	skipped = 0;
+	// state may have been changed outside of the render loop (e.g. instance buffer updates)
+	invalidate();
+}
+
+void GLStateCache::invalidate()
+{
+	program = UNKNOWN;
+	vertex_array = UNKNOWN;
+	texture = UNKNOWN;
+}
+
+void GLStateCache::use_program(GLuint program)
+{
+	if (this->program == program) {
+		skipped++;
+		return;
+	}
+	glUseProgram(program);
+	this->program = program;
+	calls++;
+}
+
+void GLStateCache::bind_vertex_array(GLuint vertex_array)
+{
+	if (this->vertex_array == vertex_array) {
+		skipped++;
+		return;
+	}
+	glBindVertexArray(vertex_array);
+	this->vertex_array = vertex_array;
+	calls++;
+}
+
+void GLStateCache::bind_texture(GLuint texture)
+{
+	if (this->texture == texture) {
+		skipped++;
+		return;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+	this->texture = texture;
+	calls++;
+}
+
+void GLStateCache::set_uniform(GLint location, float value)
+{
+	if (location < 0) return;
+	glUniform1f(location, value);
+	calls++;
+}
+
+void GLStateCache::set_uniform(GLint location, const vec2& value)
+{
+	if (location < 0) return;
+	glUniform2fv(location, 1, (float*)&value);
+	calls++;
+}
+
+void GLStateCache::set_uniform(GLint location, const vec3& value)
+{
+	if (location < 0) return;
+	glUniform3fv(location, 1, (float*)&value);
+	calls++;
+}
+
+void GLStateCache::set_uniform(GLint location, const mat3& value)
+{
+	if (location < 0) return;
+	glUniformMatrix3fv(location, 1, GL_FALSE, (float*)&value);
+	calls++;
+}
+
+void InstanceRingBuffer::begin_frame()
+{
+	calls = 0;
+	segment = (segment + 1) % INSTANCE_BUFFER_FRAMES;
+	offset = 0;
+	if (persistent) {
+		// wait for the GPU to finish the frame that last wrote this segment
+		GLsync& fence = fences[segment];
+		if (fence) {
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+			glDeleteSync(fence);
+			fence = nullptr;
+			calls += 2;
+		}
+	}
+	else if (segment == 0) {
+		// orphan the storage, queued draws keep reading the old one
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, segment_size * INSTANCE_BUFFER_FRAMES, nullptr, GL_STREAM_DRAW);
+		calls += 2;
+	}
+	gl_has_errors();
+}
+
+void InstanceRingBuffer::end_frame()
+{
+	if (!persistent) return;
+	fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	calls++;
+}
+
+void* InstanceRingBuffer::map(size_t max_bytes)
+{
+	assert(max_bytes > 0);
+	if (offset + max_bytes > segment_size) {
+		// the other segments may still be in flight, start over in a larger buffer
+		size_t new_segment_size = segment_size * 2;
+		while (new_segment_size < max_bytes) new_segment_size *= 2;
+		release();
+		create(new_segment_size);
+		printf("Instance buffer grown to %zu KB per frame\n", segment_size / 1024);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	calls++;
+	mapped_offset = segment * segment_size + offset;
+	if (persistent) {
+		return persistent_ptr + mapped_offset;
+	}
+
+	// nothing queued reads this range since the last orphan, no need to synchronize
+	void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, mapped_offset, max_bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+	assert(ptr != nullptr);
+	calls++;
+	gl_has_errors();
+	return ptr;
+}
+
+// The buffer must still be bound to GL_ARRAY_BUFFER from map
+size_t InstanceRingBuffer::unmap(size_t used_bytes)
+{
+	if (!persistent) {
+		if (used_bytes > 0) glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, used_bytes);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		calls += 2;
+		gl_has_errors();
+	}
+	// keep ranges 16 byte aligned for the attribute offsets
+	offset += (used_bytes + 15) & ~(size_t)15;
+	return mapped_offset;
+}
+
 // Helper function to get vector of strings separated by delimiter of input string
 // Adapted from: https://stackoverflow.com/a/10058725
 void RenderSystem::get_strings_delim(const std::string& input, char delim, std::vector<std::string>& output) {
@@ -15,23 +166,17 @@ void RenderSystem::get_strings_delim(const std::string& input, char delim, std::
 }
 
 // Helper function to render text with new lines
+// Each line is centered on its own, line i is moved down by i * scale * padding_y
 void RenderSystem::render_text_newline(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat3& trans, bool in_world, float padding_y, float transparency) {
 	// Prevent having to split string if there are no new lines
 	if (text.find('\n') == std::string::npos) {
 		renderText(text, x, y, scale, color, trans, in_world, transparency);
 		return;
 	}
-	std::vector<std::string> segments;
-	get_strings_delim(text, '\n', segments);
-	// Either use x, y OR Transform t. t.mat will not work together with x, y
-	//Transform t;
-	//t.mat = trans;
-	//vec2 t_translate = { 0, scale * padding_y };
-	int segments_size = segments.size();
-	for (int i = 0; i < segments_size; ++i) {
-		renderText(segments[i], x, y + i * scale * padding_y, scale, color, trans, in_world, transparency);
-		//t.translate(t_translate);
-	}
+	if (menu.state == MENU_STATE::PLAY && option.hide_ui) return;
+	// the split happens once, when the layout is built
+	const TextLayout& layout = getTextLayout(text, scale, padding_y);
+	queueTextLayout(layout, x, y, color, trans, in_world, transparency);
 }
 
 void RenderSystem::drawTexturedMesh(Entity entity,
@@ -63,9 +208,10 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	const GLuint used_effect_enum = (GLuint)(*render_request).used_effect;
 	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
 	const GLuint program = (GLuint)effects[used_effect_enum];
+	const ProgramLocations& locations = effect_locations[used_effect_enum];
 
 	// Setting shaders
-	glUseProgram(program);
+	gl_state.use_program(program);
 	gl_has_errors();
 
 	assert((*render_request).used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
@@ -73,9 +219,10 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	const GLuint ibo = index_buffers[(GLuint)(*render_request).used_geometry];
 
 	// Setting vertex and index buffers
-	glBindVertexArray(dummyVAO);
+	gl_state.bind_vertex_array(dummyVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	gl_state.count(2);
 	gl_has_errors();
 
 	// Input data location as in the vertex buffer
@@ -87,78 +234,57 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		(*render_request).used_effect == EFFECT_ASSET_ID::COMBO ||
 		(*render_request).used_effect == EFFECT_ASSET_ID::GREY)
 	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
+		assert(locations.in_texcoord >= 0);
 
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
+		glEnableVertexAttribArray(locations.in_position);
+		glVertexAttribPointer(locations.in_position, 3, GL_FLOAT, GL_FALSE,
 			sizeof(TexturedVertex), (void*)0);
 		gl_has_errors();
 
-		glEnableVertexAttribArray(in_texcoord_loc);
+		glEnableVertexAttribArray(locations.in_texcoord);
 		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
+			locations.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
 			(void*)sizeof(
 				vec3)); // note the stride to skip the preceeding vertex position
+		gl_state.count(4);
 
 		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
-		//assert(registry.renderRequests.has(entity));
-		//GLuint texture_id =
-		//	texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-		GLuint texture_id;
-		if (registry.renderRequests.has(entity)) {
-			texture_id = texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-		}
-		else if (registry.renderRequestsForeground.has(entity)) {
-			texture_id = texture_gl_handles[(GLuint)registry.renderRequestsForeground.get(entity).used_texture];
-		}
-		else {
-			assert(false && "Entity not contained in ECS registry");
-		}
+		// Note, only texture unit 0 is ever used so it is not switched
 
-		glBindTexture(GL_TEXTURE_2D, texture_id);
+		GLuint texture_id = texture_gl_handles[(GLuint)(*render_request).used_texture];
+		gl_state.bind_texture(texture_id);
 		gl_has_errors();
 		if ((*render_request).used_effect == EFFECT_ASSET_ID::PLAYER_HB && (*render_request).used_texture == TEXTURE_ASSET_ID::REIMU_HEALTH) {
 			assert(registry.players.entities.size() == 1);
-			GLint health_uloc = glGetUniformLocation(program, "health_percentage");
 			const HP& player_hp = registry.hps.get(registry.players.entities[0]);
 			float health_percentage = (float)player_hp.curr_hp / player_hp.max_hp;
-			glUniform1f(health_uloc, health_percentage);
+			gl_state.set_uniform(locations.health_percentage, health_percentage);
 			gl_has_errors();
 		}
 		else if ((*render_request).used_effect == EFFECT_ASSET_ID::PLAYER_HB && (*render_request).used_texture == TEXTURE_ASSET_ID::FOCUS_BAR) {
 			assert(registry.players.entities.size() == 1);
-			GLint health_uloc = glGetUniformLocation(program, "health_percentage");
 			//float health_percentage = registry.invulnerableTimers.has(registry.players.entities[0]) ? (float)registry.invulnerableTimers.get(registry.players.entities[0]).invulnerable_counter_ms / registry.players.components[0].invulnerability_time_ms : 1.f;
 			float health_percentage = (float)focus_mode.counter_ms / focus_mode.max_counter_ms;
-			glUniform1f(health_uloc, health_percentage);
+			gl_state.set_uniform(locations.health_percentage, health_percentage);
 			gl_has_errors();
 		}
 		else if ((*render_request).used_effect == EFFECT_ASSET_ID::BOSSHEALTHBAR && registry.bossHealthBarUIs.has(entity)) {
 			BossHealthBarLink& link = registry.bossHealthBarLink.get(entity);
-			GLint health_uloc = glGetUniformLocation(program, "health_percentage");
 			const HP* boss_hp = registry.hps.has(link.other) ? &registry.hps.get(link.other) : nullptr;
 			float health_percentage = boss_hp ? (float)boss_hp->curr_hp / boss_hp->max_hp : 0.f;
-			glUniform1f(health_uloc, health_percentage);
+			gl_state.set_uniform(locations.health_percentage, health_percentage);
 			gl_has_errors();
 		}
 		else if ((*render_request).used_effect == EFFECT_ASSET_ID::PLAYER)
 		{
-			GLint focus_uloc = glGetUniformLocation(program, "focus_mode_alpha");
 			// there will only be one focus dot
 			float focus_mode_alpha = registry.focusdots.entities.size() > 0 ? 0.5f : 1.0f;
-			glUniform1f(focus_uloc, focus_mode_alpha);
+			gl_state.set_uniform(locations.focus_mode_alpha, focus_mode_alpha);
 			gl_has_errors();
 
 			// allow hit timer to change color before being transparent
-			GLint invul_uloc = glGetUniformLocation(program, "invul_timer");
 			float invul_timer = !registry.hitTimers.has(entity) && registry.invulnerableTimers.has(entity) ? registry.invulnerableTimers.get(entity).invulnerable_counter_ms : 0.f;
-			glUniform1f(invul_uloc, invul_timer);
+			gl_state.set_uniform(locations.invul_timer, invul_timer);
 			gl_has_errors();
 		}
 		float strength = 0.2f;
@@ -174,24 +300,20 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		else if ((*render_request).used_effect == EFFECT_ASSET_ID::COMBO && (*render_request).used_texture == TEXTURE_ASSET_ID::S) {
 			strength = 0.5f;
 		}
-		GLint strength_uloc = glGetUniformLocation(program, "strength");
-		glUniform1f(strength_uloc, strength);
+		gl_state.set_uniform(locations.strength, strength);
 		gl_has_errors();
 	}
 	else if ((*render_request).used_effect == EFFECT_ASSET_ID::EGG)
 	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_color_loc = glGetAttribLocation(program, "in_color");
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
+		glEnableVertexAttribArray(locations.in_position);
+		glVertexAttribPointer(locations.in_position, 3, GL_FLOAT, GL_FALSE,
 			sizeof(ColoredVertex), (void*)0);
 		gl_has_errors();
 
-		glEnableVertexAttribArray(in_color_loc);
-		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
+		glEnableVertexAttribArray(locations.in_color);
+		glVertexAttribPointer(locations.in_color, 3, GL_FLOAT, GL_FALSE,
 			sizeof(ColoredVertex), (void*)sizeof(vec3));
+		gl_state.count(4);
 		gl_has_errors();
 	}
 	else
@@ -199,29 +321,26 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 		assert(false && "Type of render request not supported");
 	}
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
+	// Setting uniform values to the currently bound program
 	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float*)&color);
+	gl_state.set_uniform(locations.fcolor, color);
 	gl_has_errors();
 
-	GLint end_pos_uloc = glGetUniformLocation(program, "end_pos");
+	// looping animations are computed on the CPU here, sprite batches do it in the vertex shader
 	vec2 end_pos = vec2(1);
 	if (registry.animation.has(entity)) {
-		end_pos = registry.animation.get(entity).render_pos;
+		end_pos = registry.animation.get(entity).get_end_pos(uni_timer.animation_ms);
 	}
 	else if (registry.alwaysplayAni.has(entity)) {
-		end_pos = registry.alwaysplayAni.get(entity).render_pos;
+		end_pos = registry.alwaysplayAni.get(entity).get_end_pos(uni_timer.animation_ms);
 	}
 	else if (registry.playonceAni.has(entity)) {
 		end_pos = registry.playonceAni.get(entity).render_pos;
 		;
 	}
-	glUniform2fv(end_pos_uloc, 1, (float*)&end_pos);
+	gl_state.set_uniform(locations.end_pos, end_pos);
 	gl_has_errors();
 
-	GLint scale_uloc = glGetUniformLocation(program, "scale");
-
 	vec2 ani_scale = vec2(1);
 	if (registry.animation.has(entity)) {
 		ani_scale = registry.animation.get(entity).spritesheet_scale;
@@ -232,33 +351,22 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	else if (registry.playonceAni.has(entity)) {
 		ani_scale = registry.playonceAni.get(entity).spritesheet_scale;
 	}
-	glUniform2fv(scale_uloc, 1, (float*)&ani_scale);
-	gl_has_errors();
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+	gl_state.set_uniform(locations.scale, ani_scale);
 	gl_has_errors();
 
-	GLsizei num_indices = size / sizeof(uint16_t);
+	GLsizei num_indices = index_counts[(GLuint)(*render_request).used_geometry];
 	// GLsizei num_triangles = num_indices / 3;
 
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
-	GLuint view_loc = glGetUniformLocation(currProgram, "view");
-	glUniformMatrix3fv(view_loc, 1, GL_FALSE, (float*)&view);
-	GLuint view_loc_ui = glGetUniformLocation(currProgram, "view_ui");
-	glUniformMatrix3fv(view_loc_ui, 1, GL_FALSE, (float*)&view_ui);
-	GLuint time_uloc = glGetUniformLocation(currProgram, "time");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+	gl_state.set_uniform(locations.transform, transform.mat);
+	gl_state.set_uniform(locations.projection, projection);
+	gl_state.set_uniform(locations.view, view);
+	gl_state.set_uniform(locations.view_ui, view_ui);
+	gl_state.set_uniform(locations.time, (float)(glfwGetTime() * 10.0f));
 	gl_has_errors();
 	// Drawing of num_indices/3 triangles specified in the index buffer
 	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	gl_state.count();
+	draw_calls++;
 	gl_has_errors();
 }
 
@@ -266,14 +374,19 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 // wind
 void RenderSystem::drawToScreen()
 {
+	// text queued so far belongs to the off screen frame
+	flushText();
+	// the scene was drawn straight to the output framebuffer
+	if (!is_composited) return;
+
 	// Setting shaders
 	// get the wind texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WIND]);
+	gl_state.use_program(effects[(GLuint)EFFECT_ASSET_ID::WIND]);
 	gl_has_errors();
 	// Clearing backbuffer
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, output_frame_buffer);
 	glViewport(0, 0, w, h);
 	glDepthRange(0, 10);
 	glClearColor(1.f, 0, 0, 1.0);
@@ -286,40 +399,38 @@ void RenderSystem::drawToScreen()
 	glDisable(GL_DEPTH_TEST);
 
 	// Draw the screen texture on the quad geometry
-	glBindVertexArray(dummyVAO);
+	gl_state.bind_vertex_array(dummyVAO);
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
 	glBindBuffer(
 		GL_ELEMENT_ARRAY_BUFFER,
 		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
 	// indices to the bound GL_ARRAY_BUFFER
+	gl_state.count(2);
 	gl_has_errors();
-	const GLuint wind_program = effects[(GLuint)EFFECT_ASSET_ID::WIND];
+	const ProgramLocations& wind_locations = effect_locations[(GLuint)EFFECT_ASSET_ID::WIND];
 	// Set clock
-	GLuint time_uloc = glGetUniformLocation(wind_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(wind_program, "darken_screen_factor");
-	GLuint bomb_timer_uloc = glGetUniformLocation(wind_program, "bomb_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+	gl_state.set_uniform(wind_locations.time, (float)(glfwGetTime() * 10.0f));
 	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	glUniform1f(bomb_timer_uloc, screen.bomb_screen_factor);
+	gl_state.set_uniform(wind_locations.darken_screen_factor, screen.darken_screen_factor);
+	gl_state.set_uniform(wind_locations.bomb_screen_factor, screen.bomb_screen_factor);
 	gl_has_errors();
 	// Set the vertex position and vertex texture coordinates (both stored in the
 	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(wind_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+	glEnableVertexAttribArray(wind_locations.in_position);
+	glVertexAttribPointer(wind_locations.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+	gl_state.count(2);
 	gl_has_errors();
 
 	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	gl_state.bind_texture(off_screen_render_buffer_color);
 	gl_has_errors();
 	// Draw
 	glDrawElements(
 		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
 		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
 	// no offset from the bound index buffer
+	gl_state.count();
+	draw_calls++;
 	gl_has_errors();
 }
 
@@ -341,23 +452,46 @@ void RenderSystem::render_buttons(glm::mat3& projection_2D, glm::mat3& view_2D,
 		drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		renderText(button.text, motion.position.x, motion.position.y, button.text_scale, button.is_hovered ? vec3(0.03f) : vec3(0.5f), trans, false, 1.f);
 	}
+	// buttons do not overlap, their labels are drawn together on top
+	flushText();
 }
 
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
 void RenderSystem::draw()
 {
+	draw_calls = 0;
+	sprites_considered = 0;
+	sprites_drawn = 0;
+	gl_state.begin_frame();
+	instance_buffer.begin_frame();
+	profiler.begin_frame(WorldSystem::getInstance().get_show_fps());
+	// only texture unit 0 is used, every bind below goes to it
+	glActiveTexture(GL_TEXTURE0);
 	gl_has_errors();
 	// Getting size of window
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 
-	// First render to the custom framebuffer
+	// Render to the custom framebuffer only when drawToScreen has work to do: a screen effect is
+	// active or the scene is rendered below window resolution, otherwise straight to the output framebuffer
+	ScreenState& screen = registry.screenStates.get(screen_state_entity);
+	is_composited = render_scale < 1.f || screen.darken_screen_factor > 0 || screen.bomb_screen_factor > 0;
+	ivec2 scene_size = { w, h };
 	gl_has_errors();
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	if (is_composited) {
+		scene_size = max(ivec2(vec2(w, h) * render_scale), ivec2(1));
+		if (scene_size != screen_texture_size) {
+			resizeScreenTexture(scene_size);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	}
+	else {
+		glBindFramebuffer(GL_FRAMEBUFFER, output_frame_buffer);
+	}
 	gl_has_errors();
 	// Clearing backbuffer
-	glViewport(0, 0, w, h);
+	glViewport(0, 0, scene_size.x, scene_size.y);
 	glDepthRange(0.00001, 10);
 	//glClearColor(0.674, 0.847, 1.0, 1.0);
 	if (map_info.level == MAP_LEVEL::LEVEL3) {
@@ -394,13 +528,18 @@ void RenderSystem::draw()
 		// Draw all textured meshes that have a position and size component
 		std::vector<Entity> boss_ui_entities;
 		std::vector<Entity> uiux_world_entities;
+		std::vector<Entity> world_entities;
+		std::vector<Entity> unbatched_entities;
 		// Parallaxes should always at the back
+		profiler.begin(RENDER_PASS::PARALLAX);
 		for (Entity entity : registry.parrallaxes.entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
 
+		profiler.begin(RENDER_PASS::TILES);
 		drawTilesInstanced(projection_2D, view_2D);
 
+		profiler.begin(RENDER_PASS::SPRITES);
 		// Room signifier has motion, don't have to check
 		// It should be rendered at the bottom as it should not be on top of aura
 		for (Entity entity : registry.roomSignifiers.entities) {
@@ -425,38 +564,46 @@ void RenderSystem::draw()
 				render_text_newline(teleporter.optional_text_above_teleporter, new_motion.x, new_motion.y, 1.f, vec3(0, 1, 0), trans, true, 25.f, 1.f);
 			}
 		}
-
-		for (Entity entity : registry.renderRequests.entities)
+		profiler.begin(RENDER_PASS::TEXT);
+		flushText();
+
+		profiler.begin(RENDER_PASS::SPRITES);
+		updateSpriteCulling();
+		culling_candidates.clear();
+		static_sprite_grid.query(camera.getViewMin(), camera.getViewMax(), culling_candidates);
+		for (Entity entity : dynamic_sprites) {
+			culling_candidates.push_back(entity);
+		}
+		// creation order, sprites sharing a texture overlap the same way every frame
+		std::sort(culling_candidates.begin(), culling_candidates.end());
+		for (unsigned int entity_id : culling_candidates)
 		{
-			if (registry.renderRequests.get(entity).used_texture == TEXTURE_ASSET_ID::BOSS_HEALTH_BAR) {
+			Entity entity = Entity((int)entity_id);
+			// static sprites removed since the grid was built
+			if (!registry.renderRequests.has(entity)) continue;
+			sprites_considered++;
+			RENDER_LAYER layer = registry.renderRequests.get(entity).layer;
+			if (layer == RENDER_LAYER::BOSS_HEALTH_BAR) {
 				boss_ui_entities.push_back(entity);
 				continue;
 			}
 			if (!registry.motions.has(entity) || !camera.isInCameraView(registry.motions.get(entity).position)) {
 				continue;
 			}
-			if (registry.buttons.has(entity) || registry.mainMenus.has(entity) || registry.pauseMenus.has(entity)) continue;
-			if (registry.UIUXWorld.has(entity)) {
+			if (layer == RENDER_LAYER::WORLD_UI) {
 				uiux_world_entities.push_back(entity);
 				continue;
 			}
-			if (registry.aimbotCursors.has(entity)) continue;
-			if (registry.focusdots.has(entity)) continue;
-			if (registry.UIUX.has(entity)) continue;
-			if (registry.players.has(entity)) continue;
-			if (registry.dialogueMenus.has(entity)) continue;
-			if (registry.optionMenus.has(entity)) continue;
-			if (registry.winMenus.has(entity)) continue;
-			if (registry.loseMenus.has(entity)) continue;
-			if (registry.playerBullets.has(entity)) continue;
-			if (registry.infographicsMenus.has(entity)) continue;
-			if (registry.teleporters.has(entity)) continue;
-			if (registry.auras.has(entity)) continue;
-			if (registry.parrallaxes.has(entity)) continue;
-			if (registry.roomSignifiers.has(entity)) continue;
-
-			// Note, its not very efficient to access elements indirectly via the entity
-			// albeit iterating through all Sprites in sequence. A good point to optimize
+
+			sprites_drawn++;
+			world_entities.push_back(entity);
+		}
+		// Plain textured sprites are batched, the rest (e.g. debug lines) are drawn on top of them
+		queueSprites(world_entities, unbatched_entities);
+		// particles share the batch, on top of the world sprites of their texture
+		queueParticles();
+		flushSprites(projection_2D, view_2D);
+		for (Entity entity : unbatched_entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
 
@@ -466,6 +613,7 @@ void RenderSystem::draw()
 		}
 
 		// World texts:
+		profiler.begin(RENDER_PASS::TEXT);
 		for (Entity entity : registry.textsWorld.entities) {
 			Motion& text_motion = registry.motions.get(entity);
 			if (!camera.isInCameraView(registry.motions.get(entity).position)) continue;
@@ -489,39 +637,101 @@ void RenderSystem::draw()
 
 			render_text_newline(text_cont.content, text_motion.position.x, text_motion.position.y, text_motion.scale.x, text_color, trans, true, 25.f, text_cont.transparency);
 		}
+		flushText();
 
 		// Render player
+		profiler.begin(RENDER_PASS::SPRITES);
 		for (Entity entity : registry.players.entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
 
+		std::vector<Entity> player_bullet_entities;
 		for (Entity entity : registry.playerBullets.entities) {
 			if (!camera.isInCameraView(registry.motions.get(entity).position)) continue;
+			player_bullet_entities.push_back(entity);
+		}
+		unbatched_entities.clear();
+		queueSprites(player_bullet_entities, unbatched_entities);
+		for (Entity entity : unbatched_entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
+		flushSprites(projection_2D, view_2D);
 
 		// Render instance of visible enemy bullets
-		std::vector<Entity> enemy_bullets;
-		for (Entity entity : registry.enemyBullets.entities) {
-			if (registry.motions.has(entity) && camera.isInCameraView(registry.motions.get(entity).position)) {
-				enemy_bullets.push_back(entity);
+		profiler.begin(RENDER_PASS::BULLETS);
+		// Transforms of visible bullets are built by the workers, each range into its own slice of bullet_transforms
+		int bullet_count = registry.enemyBullets.size();
+		bullet_transforms.resize(bullet_count);
+		bullet_ranges.assign(workers->max_ranges(), ivec2(0));
+		workers->parallel_for(bullet_count, DRAW_LIST_MIN_RANGE, [this](int range, int first, int last) {
+			int amount = 0;
+			for (int i = first; i < last; i++) {
+				Entity entity = registry.enemyBullets.entities[i];
+				if (!registry.motions.has(entity)) continue;
+				Motion& motion = registry.motions.get(entity);
+				if (!camera.isInCameraView(motion.position)) continue;
+				Transform transform;
+				transform.translate(motion.position);
+				transform.rotate(motion.angle);
+				transform.scale(motion.scale);
+				bullet_transforms[first + amount++] = transform.mat;
 			}
+			bullet_ranges[range] = { first, amount };
+		});
+
+		size_t max_bullets = 0;
+		for (ivec2 range : bullet_ranges) {
+			max_bullets += range.y;
+		}
+		for (BulletDissolve& dissolve : registry.bulletDissolves.components) {
+			max_bullets += dissolve.positions.size();
+		}
+		if (max_bullets > 0) {
+			// mapped for the worst case of no dissolving bullet culled
+			mat3* enemy_bullet_transforms = (mat3*)instance_buffer.map(sizeof(mat3) * max_bullets);
+			int amount = 0;
+			for (ivec2 range : bullet_ranges) {
+				memcpy(enemy_bullet_transforms + amount, bullet_transforms.data() + range.x, sizeof(mat3) * range.y);
+				amount += range.y;
+			}
+
+			// Dissolving bullets shrink with their remaining time, drawn in the same instanced call
+			for (BulletDissolve& dissolve : registry.bulletDissolves.components) {
+				float remaining = max(dissolve.counter_ms, 0.f) / dissolve.max_counter_ms;
+				for (size_t i = 0; i < dissolve.positions.size(); ++i) {
+					if (!camera.isInCameraView(dissolve.positions[i])) continue;
+					Transform transform;
+					transform.translate(dissolve.positions[i]);
+					transform.rotate(dissolve.angles[i]);
+					transform.scale(dissolve.scales[i] * remaining);
+					enemy_bullet_transforms[amount++] = transform.mat;
+				}
+			}
+			size_t instance_offset = instance_buffer.unmap(sizeof(mat3) * amount);
+			drawBulletsInstanced(instance_offset, amount, projection_2D, view_2D);
 		}
-		drawBulletsInstanced(enemy_bullets, projection_2D, view_2D);
 
 		// this will only have at most one focusdots
 		// it will always be in camera view, and has motion
+		profiler.begin(RENDER_PASS::SPRITES);
 		for (Entity entity : registry.focusdots.entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
 
 		// Render foreground entities, these will be in front of things rendered before
+		std::vector<Entity> foreground_entities;
 		for (Entity entity : registry.renderRequestsForeground.entities) {
 			if (!registry.motions.has(entity) || !camera.isInCameraView(registry.motions.get(entity).position)) {
 				continue;
 			}
+			foreground_entities.push_back(entity);
+		}
+		unbatched_entities.clear();
+		queueSprites(foreground_entities, unbatched_entities);
+		for (Entity entity : unbatched_entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
+		flushSprites(projection_2D, view_2D);
 
 		// this will only have at most one aimbot cursor
 		// it will always be in camera view, and has motion
@@ -529,6 +739,7 @@ void RenderSystem::draw()
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
 
+		profiler.begin(RENDER_PASS::TEXT);
 		for (Entity entity : registry.pickupables.entities) {
 			if (!registry.motions.has(entity) || !camera.isInCameraView(registry.motions.get(entity).position)) continue;
 			const Motion& motion = registry.motions.get(entity);
@@ -537,10 +748,13 @@ void RenderSystem::draw()
 			renderText("HP Up+", motion.position.x, motion.position.y + 25, 0.5f, glm::vec3(0.0f, 0.8f, 0.0f), trans, true, 1.f);
 		}
 
-		if (registry.visibilityTileInstanceData.components.size() > 0) {
-			drawVisibilityTilesInstanced(projection_2D, view_2D);
+		flushText();
+		if (fog_size.x > 0 && visibility_info.excluded.find(map_info.level) == visibility_info.excluded.end()) {
+			profiler.begin(RENDER_PASS::FOG);
+			drawFog(projection_2D, view_2D);
 		}
 
+		profiler.begin(RENDER_PASS::UI);
 		if (menu.state != MENU_STATE::DIALOGUE) {
 			if (menu.state == MENU_STATE::PAUSE || !option.hide_ui) {
 				for (Entity entity : registry.UIUX.entities) {
@@ -556,9 +770,25 @@ void RenderSystem::draw()
 			}
 		}
 
+		profiler.begin(RENDER_PASS::TEXT);
 		if (WorldSystem::getInstance().get_show_fps() == true) {
 			renderText("FPS:", window_width_px / 2.6f, -window_height_px / 2.2f, 1.0f, glm::vec3(0, 1, 0), trans, false, 1.f);
 			renderText(WorldSystem::getInstance().get_fps_in_string(), window_width_px / 2.2f, -window_height_px / 2.2f, 1.0f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			// draw calls of the previous frame, this frame is still being drawn
+			renderText("Draws:", window_width_px / 2.6f, -window_height_px / 2.35f, 0.6f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			renderText(std::to_string(last_frame_draw_calls), window_width_px / 2.2f, -window_height_px / 2.35f, 0.6f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			renderText("Calls:", window_width_px / 2.6f, -window_height_px / 2.5f, 0.6f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			renderText(std::to_string(last_frame_gl_calls), window_width_px / 2.2f, -window_height_px / 2.5f, 0.6f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			// render requests drawn / visited by culling
+			renderText("Sprites:", window_width_px / 2.6f, -window_height_px / 2.5f + 25.f, 0.6f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			renderText(std::to_string(last_frame_sprites_drawn) + "/" + std::to_string(last_frame_sprites_considered), window_width_px / 2.2f, -window_height_px / 2.5f + 25.f, 0.6f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			// mean pass times of the last profiler window
+			renderText("ms    cpu    gpu", window_width_px / 3.6f, -window_height_px / 2.5f + 50.f, 0.5f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			for (int i = 0; i < pass_count; i++) {
+				char pass_times[64];
+				snprintf(pass_times, sizeof(pass_times), "%s  %.2f  %.2f", render_pass_name((RENDER_PASS)i), profiler.cpu_ms[i], profiler.gpu_ms[i]);
+				renderText(pass_times, window_width_px / 3.6f, -window_height_px / 2.5f + 50.f + 18.f * (i + 1), 0.5f, glm::vec3(0, 1, 0), trans, false, 1.f);
+			}
 		}
 
 		// On screen/ui texts:
@@ -577,11 +807,15 @@ void RenderSystem::draw()
 				RenderTextPermanent& text_cont = registry.textsPerm.get(entity);
 				renderText(text_cont.content, text_motion.position.x, text_motion.position.y, text_motion.scale.x, text_color, trans, false, text_cont.transparency);
 			}
+			// HUD and FPS text in one draw, under the menus below
+			flushText();
 		}
 		if (menu.state == MENU_STATE::DIALOGUE) {
+			profiler.begin(RENDER_PASS::UI);
 			for (Entity entity : registry.dialogueMenus.entities) {
 				drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 			}
+			profiler.begin(RENDER_PASS::TEXT);
 			for (Entity entity : registry.texts.entities) {
 				Motion& text_motion = registry.motions.get(entity);
 				vec3 text_color = registry.colors.get(entity);
@@ -591,12 +825,15 @@ void RenderSystem::draw()
 			for (Entity entity : registry.textsPerm.entities) {
 				if (registry.winMenus.has(entity)) continue;
 				if (registry.loseMenus.has(entity)) continue;
+				RenderTextPermanent& text_cont = registry.textsPerm.get(entity);
+				if (text_cont.is_hud) continue;
 				Motion& text_motion = registry.motions.get(entity);
 				vec3 text_color = registry.colors.get(entity);
-				RenderTextPermanent& text_cont = registry.textsPerm.get(entity);
 				render_text_newline(text_cont.content, text_motion.position.x, text_motion.position.y, text_motion.scale.x, text_color, trans, false, 50.f, text_cont.transparency);
 			}
+			flushText();
 		}
+		profiler.begin(RENDER_PASS::UI);
 		if (menu.state == MENU_STATE::INFOGRAPHIC) {
 			for (Entity entity : registry.infographicsMenus.entities) {
 				drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
@@ -627,7 +864,9 @@ void RenderSystem::draw()
 			render_buttons(projection_2D, view_2D, view_2D_ui, MENU_STATE::WIN);
 		}
 		if (menu.state == MENU_STATE::LOSE) {
+			profiler.begin(RENDER_PASS::TO_SCREEN);
 			drawToScreen();
+			profiler.begin(RENDER_PASS::UI);
 			// To prevent black boxes (Credit: piazza @176_f1)
 			glEnable(GL_BLEND);
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -647,6 +886,7 @@ void RenderSystem::draw()
 
 	}
 	else if (menu.state == MENU_STATE::MAIN_MENU || menu.state == MENU_STATE::OPTIONS) {
+		profiler.begin(RENDER_PASS::UI);
 		for (Entity entity : registry.mainMenus.entities) {
 			drawTexturedMesh(entity, projection_2D, view_2D, view_2D_ui);
 		}
@@ -666,106 +906,219 @@ void RenderSystem::draw()
 	// as we need draw lose screen after drawToScreen call
 	if (menu.state != MENU_STATE::LOSE) {
 		// Truely render to the screen
+		profiler.begin(RENDER_PASS::TO_SCREEN);
 		drawToScreen();
 	}
+	// text drawn straight to the screen, e.g. on the lose screen
+	profiler.begin(RENDER_PASS::TEXT);
+	flushText();
+	profiler.end_frame();
+	// sweep the layout cache about once a second
+	text_layout_frame++;
+	if (text_layout_frame % TEXT_LAYOUT_MAX_UNUSED_FRAMES == 0) {
+		evictTextLayouts();
+	}
+	instance_buffer.end_frame();
+	last_frame_draw_calls = draw_calls;
+	last_frame_sprites_considered = sprites_considered;
+	last_frame_sprites_drawn = sprites_drawn;
+	last_frame_gl_calls = gl_state.calls + instance_buffer.calls;
+
+	// back buffer content is undefined after the swap
+	if (!snapshot_path.empty()) {
+		writeSnapshot();
+	}
 
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
 	gl_has_errors();
 }
 
+void RenderSystem::writeSnapshot()
+{
+	int w, h;
+	glfwGetFramebufferSize(window, &w, &h);
+	std::vector<unsigned char> pixels((size_t)w * h * 4);
+	glBindFramebuffer(GL_FRAMEBUFFER, output_frame_buffer);
+	glReadBuffer(output_frame_buffer != 0 ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	gl_has_errors();
+
+	// OpenGL rows go bottom to top
+	const size_t row_size = (size_t)w * 4;
+	std::vector<unsigned char> row(row_size);
+	for (int y = 0; y < h / 2; y++) {
+		unsigned char* top = pixels.data() + y * row_size;
+		unsigned char* bottom = pixels.data() + (h - 1 - y) * row_size;
+		std::copy(top, top + row_size, row.begin());
+		std::copy(bottom, bottom + row_size, top);
+		std::copy(row.begin(), row.end(), bottom);
+	}
+	if (!write_png(snapshot_path, w, h, pixels.data())) {
+		fprintf(stderr, "Could not write snapshot %s\n", snapshot_path.c_str());
+	}
+	snapshot_path.clear();
+}
+
 // This adapted from lecture material (Wednesday Feb 28th 2024)
 // fully transparent when transparency_rate = 0
 void RenderSystem::renderText(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat3& trans, bool in_world, float transparency_rate) {
 	if (menu.state == MENU_STATE::PLAY && option.hide_ui) return;
-	// activate the shaders!
-	glUseProgram(m_font_shaderProgram);
+	const TextLayout& layout = getTextLayout(text, scale, 0.f);
+	queueTextLayout(layout, x, y, color, trans, in_world, transparency_rate);
+}
 
-	unsigned int textColor_location =
-		glGetUniformLocation(
-			m_font_shaderProgram,
-			"textColor"
-		);
-	assert(textColor_location >= 0);
-	glUniform3f(textColor_location, color.x, color.y, color.z);
+const TextLayout& RenderSystem::getTextLayout(const std::string& text, float scale, float line_spacing)
+{
+	std::vector<TextLayout>& layouts = text_layouts[text];
+	for (TextLayout& layout : layouts) {
+		if (layout.font_size == font_size && layout.scale == scale && layout.line_spacing == line_spacing) {
+			layout.last_used_frame = text_layout_frame;
+			return layout;
+		}
+	}
 
-	auto transparency_location = glGetUniformLocation(m_font_shaderProgram, "transparency");
-	assert(transparency_location > -1);
-	glUniform1f(transparency_location, transparency_rate);
+	TextLayout layout;
+	layout.font_size = font_size;
+	layout.scale = scale;
+	layout.line_spacing = line_spacing;
+	layout.last_used_frame = text_layout_frame;
+	if (line_spacing == 0.f) {
+		layoutTextLine(text, scale, 0.f, layout.vertices);
+	}
+	else {
+		std::vector<std::string> segments;
+		get_strings_delim(text, '\n', segments);
+		int segments_size = segments.size();
+		for (int i = 0; i < segments_size; ++i) {
+			// y is flipped, lines further down have a lower y
+			layoutTextLine(segments[i], scale, -i * scale * line_spacing, layout.vertices);
+		}
+	}
+	layouts.push_back(std::move(layout));
+	return layouts.back();
+}
 
-	// flip both y axis so translations will match opengl
-	y = -1 * y;
-	Transform t;
-	t.mat = trans;
-	t.scale({ 1, -1 });
+// Appends the glyph quads of one line, centered on (0, y_offset)
+void RenderSystem::layoutTextLine(const std::string& line, float scale, float y_offset, std::vector<vec4>& vertices)
+{
+	// Lay the glyphs out from the origin in a single pass, centered once the full size is known
+	// https://gamedev.stackexchange.com/q/178035
+	const size_t first_vertex = vertices.size();
+	float pen_x = 0.f;
+	float text_height = 0.f;
+	for (char c : line)
+	{
+		if ((unsigned char)c >= FONT_CHARACTER_COUNT) continue;
+		const Character& ch = m_ftCharacters[(unsigned char)c];
 
-	auto transform_location = glGetUniformLocation(m_font_shaderProgram, "transform");
-	assert(transform_location > -1);
-	glUniformMatrix3fv(transform_location, 1, GL_FALSE, glm::value_ptr(t.mat));
+		float xpos = pen_x + ch.Bearing.x * scale;
+		float ypos = -(ch.Size.y - ch.Bearing.y) * scale;
 
-	// apply view matrix, origin is now center of the screen
-	// e.g. passing in x=0, y=0 will automatically translate to world_center
-	glm::mat3 view = in_world ? camera.createViewMatrix() : ui.createViewMatrix();
-	GLint view_location = glGetUniformLocation(m_font_shaderProgram, "view");
-	assert(view_location > -1);
-	glUniformMatrix3fv(view_location, 1, GL_FALSE, glm::value_ptr(view));
+		float w = ch.Size.x * scale;
+		float h = ch.Size.y * scale;
 
-	glBindVertexArray(m_font_VAO);
+		// glyph rectangle in the atlas, v grows down the glyph bitmap
+		float u0 = ch.UVRect.x;
+		float v0 = ch.UVRect.y;
+		float u1 = ch.UVRect.x + ch.UVRect.z;
+		float v1 = ch.UVRect.y + ch.UVRect.w;
 
-	// https://gamedev.stackexchange.com/q/178035
-	float offset_x = 0.f;
-	float offset_y = 0.f;
-	for (auto c = text.begin(); c != text.end(); c++) {
-		Character ch = m_ftCharacters[*c];
-		// advance is length of current glyph to next glyph
-		offset_x += (ch.Advance >> 6) * scale;
+		vertices.push_back({ xpos,     ypos + h, u0, v0 });
+		vertices.push_back({ xpos,     ypos,     u0, v1 });
+		vertices.push_back({ xpos + w, ypos,     u1, v1 });
+
+		vertices.push_back({ xpos,     ypos + h, u0, v0 });
+		vertices.push_back({ xpos + w, ypos,     u1, v1 });
+		vertices.push_back({ xpos + w, ypos + h, u1, v0 });
+
+		// now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+		pen_x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64)
 		// size is entire glyph size, need to shift equally for different glyph heights
-		offset_y = max(offset_y, ch.Size.y * scale);
+		text_height = max(text_height, h);
 	}
-	offset_x /= 2.f;
-	offset_y /= 2.f;
 
-	// iterate through all characters
-	std::string::const_iterator c;
-	for (c = text.begin(); c != text.end(); c++)
-	{
-		Character ch = m_ftCharacters[*c];
+	// center the line on the origin
+	const vec2 center_offset = { -pen_x / 2.f, y_offset - text_height / 2.f };
+	for (size_t i = first_vertex; i < vertices.size(); i++) {
+		vertices[i].x += center_offset.x;
+		vertices[i].y += center_offset.y;
+	}
+}
 
-		float xpos = x + ch.Bearing.x * scale - offset_x;
-		float ypos = y - (ch.Size.y - ch.Bearing.y) * scale - offset_y;
+void RenderSystem::queueTextLayout(const TextLayout& layout, float x, float y, const glm::vec3& color, const glm::mat3& trans, bool in_world, float transparency_rate)
+{
+	// world text moves with the camera, the rest is placed relative to the screen center
+	std::vector<TextVertex>& vertices = in_world ? text_world_vertices : text_ui_vertices;
+	const vec4 vertex_color = vec4(color, transparency_rate);
 
-		float w = ch.Size.x * scale;
-		float h = ch.Size.y * scale;
+	// flip both y axis so translations will match opengl
+	Transform t;
+	t.mat = trans;
+	t.scale({ 1, -1 });
+	const vec2 origin = { x, -1 * y };
 
-		// update VBO for each character
-		float vertices[6][4] = {
-			{ xpos,     ypos + h,   0.0f, 0.0f },
-			{ xpos,     ypos,       0.0f, 1.0f },
-			{ xpos + w, ypos,       1.0f, 1.0f },
+	// place the cached quads and apply the transform, the view is applied by the shader
+	for (const vec4& vertex : layout.vertices) {
+		vec2 position = vec2(t.mat * vec3(origin + vec2(vertex.x, vertex.y), 1.f));
+		vertices.push_back({ position, { vertex.z, vertex.w }, vertex_color });
+	}
+}
 
-			{ xpos,     ypos + h,   0.0f, 0.0f },
-			{ xpos + w, ypos,       1.0f, 1.0f },
-			{ xpos + w, ypos + h,   1.0f, 0.0f }
-		};
+void RenderSystem::evictTextLayouts()
+{
+	for (auto it = text_layouts.begin(); it != text_layouts.end();) {
+		std::vector<TextLayout>& layouts = it->second;
+		layouts.erase(std::remove_if(layouts.begin(), layouts.end(), [&](const TextLayout& layout) {
+			return text_layout_frame - layout.last_used_frame > TEXT_LAYOUT_MAX_UNUSED_FRAMES;
+		}), layouts.end());
+		if (layouts.empty()) {
+			it = text_layouts.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
 
-		// render glyph texture over quad
-		glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-		// std::cout << "binding texture: " << ch.character << " = " << ch.TextureID << std::endl;
+void RenderSystem::flushText()
+{
+	drawTextLayer(text_world_vertices, camera.createViewMatrix());
+	// apply view matrix, origin is now center of the screen
+	// e.g. passing in x=0, y=0 will automatically translate to world_center
+	drawTextLayer(text_ui_vertices, ui.createViewMatrix());
+}
 
-		// update text of VBO memory
-		glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+void RenderSystem::drawTextLayer(std::vector<TextVertex>& vertices, const mat3& view)
+{
+	int amount = vertices.size();
+	if (amount == 0) return; // nothing to draw
 
-		// render quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+	TextVertex* stream = (TextVertex*)instance_buffer.map(sizeof(TextVertex) * amount);
+	memcpy(stream, vertices.data(), sizeof(TextVertex) * amount);
+	size_t offset = instance_buffer.unmap(sizeof(TextVertex) * amount);
 
-		// now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-		x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64)
-	}
+	// activate the shaders!
+	gl_state.use_program(m_font_shaderProgram);
+	gl_state.set_uniform(font_locations.view, view);
+
+	// the instance buffer is still bound from map
+	gl_state.bind_vertex_array(m_font_VAO);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offset);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)(offset + sizeof(vec2) * 2));
+	gl_state.bind_texture(m_font_atlas);
+	gl_has_errors();
 
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glDrawArrays(GL_TRIANGLES, 0, amount);
+	draw_calls++;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state.count(4);
+	gl_state.bind_vertex_array(0);
+	gl_has_errors();
+
+	// keep the capacity for the next frame
+	vertices.clear();
 }
 
 
@@ -787,54 +1140,38 @@ mat3 RenderSystem::createProjectionMatrix()
 }
 
 // Adapted from: https://learnopengl.com/Advanced-OpenGL/Instancing
-void RenderSystem::drawBulletsInstanced(const std::vector<Entity>& entities, const glm::mat3& projection, const glm::mat3& view)
+void RenderSystem::drawBulletsInstanced(size_t instance_offset, int amount, const glm::mat3& projection, const glm::mat3& view)
 {
-	int amount = entities.size();
-
 	if (amount == 0) return; // nothing to draw
 
-	mat3* instance_transforms = new mat3[amount];
-	for (int i = 0; i < amount; ++i) {
-		Motion& motion = registry.motions.get(entities[i]);
-		Transform transform;
-		transform.translate(motion.position);
-		transform.rotate(motion.angle);
-		transform.scale(motion.scale);
-		instance_transforms[i] = transform.mat;
-	}
+	const ProgramLocations& locations = enemy_bullet_instance_locations;
 
 	// Setting shaders
-	glUseProgram(enemy_bullet_instance_program);
+	gl_state.use_program(enemy_bullet_instance_program);
 	gl_has_errors();
 
 	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 
 	// Setting vertex and index buffers
-	glBindVertexArray(enemy_bullet_instance_VAO);
+	gl_state.bind_vertex_array(enemy_bullet_instance_VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	gl_state.count(2);
 	gl_has_errors();
 
 	// Input data location as in the vertex buffer
-	GLint in_position_loc = glGetAttribLocation(enemy_bullet_instance_program, "in_position");
-	GLint in_texcoord_loc = glGetAttribLocation(enemy_bullet_instance_program, "in_texcoord");
-	GLint in_transform_loc = glGetAttribLocation(enemy_bullet_instance_program, "in_transform");
-	gl_has_errors();
-	assert(in_position_loc >= 0);
-	assert(in_texcoord_loc >= 0);
-	assert(in_transform_loc >= 0);
+	assert(locations.in_position >= 0);
+	assert(locations.in_texcoord >= 0);
 
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
+	glEnableVertexAttribArray(locations.in_position);
+	glVertexAttribPointer(locations.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
 	gl_has_errors();
 
-	glEnableVertexAttribArray(in_texcoord_loc);
+	glEnableVertexAttribArray(locations.in_texcoord);
 	// note the stride to skip the preceeding vertex position
-	glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
-
-	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
+	glVertexAttribPointer(locations.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+	gl_state.count(4);
 	gl_has_errors();
 
 	GLuint texture_id;
@@ -852,52 +1189,242 @@ void RenderSystem::drawBulletsInstanced(const std::vector<Entity>& entities, con
 		texture_id = texture_gl_handles[(GLuint)TEXTURE_ASSET_ID::ENEMY_BULLET];
 	}
 
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	gl_state.bind_texture(texture_id);
 	gl_has_errors();
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(enemy_bullet_instance_program, "fcolor");
-	//const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float*)&color);
+	// Bullets are not animated, sample the whole texture
+	gl_state.set_uniform(locations.fcolor, vec3(1));
+	gl_state.set_uniform(locations.end_pos, vec2(1));
+	gl_state.set_uniform(locations.scale, vec2(1));
 	gl_has_errors();
 
-	GLint end_pos_uloc = glGetUniformLocation(enemy_bullet_instance_program, "end_pos");
-	//const vec2 end_pos = registry.animation.has(entity) ? registry.animation.get(entity).render_pos : vec2(1);
-	const vec3 end_pos = vec3(1);
-	glUniform2fv(end_pos_uloc, 1, (float*)&end_pos);
-	gl_has_errors();
+	GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+	// GLsizei num_triangles = num_indices / 3;
 
-	GLint scale_uloc = glGetUniformLocation(enemy_bullet_instance_program, "scale");
-	//const vec2 ani_scale = registry.animation.has(entity) ? registry.animation.get(entity).spritesheet_scale : vec2(1);
-	const vec3 ani_scale = vec3(1);
-	glUniform2fv(scale_uloc, 1, (float*)&ani_scale);
+	gl_state.set_uniform(locations.projection, projection);
+	gl_state.set_uniform(locations.view, view);
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+	// transform columns of this frame's instances
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.get_buffer());
+	for (int i = 0; i < 3; i++) {
+		glVertexAttribPointer(enemy_bullet_transform_loc + i, 3, GL_FLOAT, GL_FALSE, sizeof(mat3), (void*)(instance_offset + sizeof(vec3) * i));
+	}
+	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, 0, amount);
+	draw_calls++;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	gl_state.count(7);
+	gl_state.bind_vertex_array(0);
 	gl_has_errors();
+}
 
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
+void RenderSystem::updateSpriteCulling()
+{
+	// entity ids are never reused, only the ids handed out since the last frame can be new render requests
+	bool has_new_static_sprites = false;
+	for (unsigned int id = next_unsorted_entity; id < Entity::next_id(); id++) {
+		Entity entity = Entity((int)id);
+		if (!registry.renderRequests.has(entity)) continue;
+		// the other layers are drawn by passes of their own
+		RENDER_LAYER layer = registry.renderRequests.get(entity).layer;
+		if (layer != RENDER_LAYER::WORLD && layer != RENDER_LAYER::WORLD_UI && layer != RENDER_LAYER::BOSS_HEALTH_BAR) continue;
+		if ((registry.walls.has(entity) || registry.doors.has(entity)) && registry.motions.has(entity)) {
+			static_sprites.push_back(entity);
+			has_new_static_sprites = true;
+		}
+		else {
+			dynamic_sprites.push_back(entity);
+		}
+	}
+	next_unsorted_entity = Entity::next_id();
+
+	// static sprites are added in bursts when a map is generated, removed ones are dropped on the next rebuild
+	if (has_new_static_sprites) {
+		static_sprite_grid.clear();
+		size_t live_count = 0;
+		for (Entity entity : static_sprites) {
+			if (!registry.renderRequests.has(entity) || !registry.motions.has(entity)) continue;
+			static_sprites[live_count++] = entity;
+			static_sprite_grid.insert(entity, registry.motions.get(entity).position);
+		}
+		static_sprites.resize(live_count);
+		static_sprite_grid.build(TILE_CHUNK_SIZE * world_tile_size);
+	}
+
+	dynamic_sprites.erase(std::remove_if(dynamic_sprites.begin(), dynamic_sprites.end(), [](Entity entity) {
+		return !registry.renderRequests.has(entity);
+		}), dynamic_sprites.end());
+}
+
+void RenderSystem::queueSprites(const std::vector<Entity>& entities, std::vector<Entity>& unbatched)
+{
+	// every entity gets a slot, the slots of unbatched ones are closed below
+	size_t first_item = sprite_batch.size();
+	sprite_batch.resize(first_item + entities.size());
+	sprite_is_batched.resize(entities.size());
+	workers->parallel_for((int)entities.size(), DRAW_LIST_MIN_RANGE, [&](int range, int first, int last) {
+		for (int i = first; i < last; i++) {
+			SpriteBatchItem& item = sprite_batch[first_item + i];
+			sprite_is_batched[i] = buildSpriteItem(entities[i], item);
+			item.order = (int)(first_item + i);
+		}
+	});
+
+	size_t item_count = first_item;
+	for (size_t i = 0; i < entities.size(); i++) {
+		if (!sprite_is_batched[i]) {
+			unbatched.push_back(entities[i]);
+			continue;
+		}
+		sprite_batch[item_count++] = sprite_batch[first_item + i];
+	}
+	sprite_batch.resize(item_count);
+}
+
+bool RenderSystem::buildSpriteItem(Entity entity, SpriteBatchItem& item)
+{
+	RenderRequest* render_request;
+	if (registry.renderRequests.has(entity)) {
+		render_request = &registry.renderRequests.get(entity);
+	}
+	else if (registry.renderRequestsForeground.has(entity)) {
+		render_request = &registry.renderRequestsForeground.get(entity);
+	}
+	else {
+		return false;
+	}
+
+	// other effects set per entity uniforms (e.g. health percentage), they are drawn one by one
+	if (render_request->used_effect != EFFECT_ASSET_ID::TEXTURED ||
+		render_request->used_geometry != GEOMETRY_BUFFER_ID::SPRITE) {
+		return false;
+	}
 
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
-	GLuint view_loc = glGetUniformLocation(currProgram, "view");
-	glUniformMatrix3fv(view_loc, 1, GL_FALSE, (float*)&view);
+	// packed textures are drawn from their atlas page, so sprites of different textures share a batch
+	item.texture = getSpriteTexture(render_request->used_texture);
+	item.instance.uv_rect = texture_atlas_rect[(int)render_request->used_texture];
+	item.sort_key = render_request->sort_key;
+
+	Motion& motion = registry.motions.get(entity);
+	Transform transform;
+	transform.translate(motion.position);
+	transform.rotate(motion.angle);
+	transform.scale(motion.scale);
+	item.instance.transform = transform.mat;
+	item.instance.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+
+	// same sprite sheet lookup as drawTexturedMesh, looping animations advance in the vertex shader
+	item.instance.end_pos = vec2(1);
+	item.instance.scale = vec2(1);
+	item.instance.animation = vec2(0);
+	if (registry.animation.has(entity) || registry.alwaysplayAni.has(entity)) {
+		EntityAnimation& ani = registry.animation.has(entity) ? registry.animation.get(entity) : registry.alwaysplayAni.get(entity);
+		item.instance.end_pos = ani.render_pos;
+		item.instance.scale = ani.spritesheet_scale;
+		if (ani.is_active && ani.spritesheet_scale.x > 0) {
+			item.instance.animation = { ani.start_ms, ani.full_rate_ms };
+		}
+	}
+	else if (registry.playonceAni.has(entity)) {
+		EntityAnimation& ani = registry.playonceAni.get(entity);
+		item.instance.end_pos = ani.render_pos;
+		item.instance.scale = ani.spritesheet_scale;
+	}
+	return true;
+}
+
+GLuint RenderSystem::getSpriteTexture(TEXTURE_ASSET_ID id) const
+{
+	const int texture_id = (int)id;
+	if (texture_atlas_page[texture_id] >= 0) {
+		return atlas_gl_handles[texture_atlas_page[texture_id]];
+	}
+	return texture_gl_handles[texture_id];
+}
+
+void RenderSystem::queueParticles()
+{
+	for (int type = 0; type < vfx_type_count; type++) {
+		const ParticleSystem::Pool& pool = particles.pool((VFX_TYPE)type);
+		if (pool.count == 0) continue;
+		const ParticleEffect& effect = particle_effect((VFX_TYPE)type);
+
+		SpriteBatchItem item;
+		item.sort_key = 0;
+		item.texture = getSpriteTexture(effect.texture);
+		item.instance.uv_rect = texture_atlas_rect[(int)effect.texture];
+		item.instance.color = vec3(1);
+		item.instance.scale = { 1.f / effect.frame_count, 1.f };
+		item.instance.animation = vec2(0);
+		for (int i = 0; i < pool.count; i++) {
+			if (!camera.isInCameraView(pool.positions[i])) continue;
+			Transform transform;
+			transform.translate(pool.positions[i]);
+			transform.rotate(pool.angles[i]);
+			transform.scale(pool.scales[i]);
+			item.instance.transform = transform.mat;
+			// same sprite sheet lookup as a play once EntityAnimation
+			item.instance.end_pos = { (float)(pool.frames[i] + 1) / effect.frame_count, 1.f };
+			item.order = (int)sprite_batch.size();
+			sprite_batch.push_back(item);
+		}
+	}
+}
+
+void RenderSystem::flushSprites(const mat3& projection, const mat3& view)
+{
+	int amount = sprite_batch.size();
+	if (amount == 0) return; // nothing to draw
+
+	// Group sprites by texture or atlas page, ties keep submission order
+	std::sort(sprite_batch.begin(), sprite_batch.end(), [](const SpriteBatchItem& a, const SpriteBatchItem& b) {
+		if (a.sort_key != b.sort_key) return a.sort_key < b.sort_key;
+		if (a.texture != b.texture) return a.texture < b.texture;
+		return a.order < b.order;
+	});
+
+	// sorted instances go straight into the instance buffer, which stays bound for the attribute pointers
+	SpriteInstanceData* instances = (SpriteInstanceData*)instance_buffer.map(sizeof(SpriteInstanceData) * amount);
+	for (int i = 0; i < amount; i++) {
+		instances[i] = sprite_batch[i].instance;
+	}
+	size_t instance_offset = instance_buffer.unmap(sizeof(SpriteInstanceData) * amount);
+
+	gl_state.use_program(sprite_instance_program);
+	gl_state.bind_vertex_array(sprite_instance_VAO);
 	gl_has_errors();
 
-	glBindBuffer(GL_ARRAY_BUFFER, enemy_bullet_instance_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(mat3) * amount, instance_transforms, GL_DYNAMIC_DRAW);
-	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, 0, amount);
+	gl_state.set_uniform(sprite_instance_locations.projection, projection);
+	gl_state.set_uniform(sprite_instance_locations.view, view);
+	gl_state.set_uniform(sprite_instance_locations.time, uni_timer.animation_ms);
+	gl_has_errors();
+
+	GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+
+	// One instanced draw per run of sprites sharing a texture or atlas page
+	int start = 0;
+	while (start < amount) {
+		GLuint texture = sprite_batch[start].texture;
+		int end = start + 1;
+		while (end < amount && sprite_batch[end].texture == texture) end++;
+
+		setSpriteInstanceAttributes(instance_offset + start * sizeof(SpriteInstanceData));
+		gl_state.bind_texture(texture);
+		glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, 0, end - start);
+		// eight attribute pointers and the draw
+		gl_state.count(9);
+		draw_calls++;
+		gl_has_errors();
+
+		start = end;
+	}
+
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	gl_state.count();
+	gl_state.bind_vertex_array(0);
 	gl_has_errors();
-	delete[] instance_transforms;
+	sprite_batch.clear();
 }
 
 vec4 RenderSystem::get_spriteloc(TILE_NAME tile_name) {
@@ -1111,11 +1638,54 @@ vec4 RenderSystem::get_spriteloc(TILE_NAME tile_name) {
 	return spriteloc / DIVISOR;
 }
 
+// Groups tile instances into TILE_CHUNK_SIZE square chunks ordered row by row
+// order receives the instance indices sorted by chunk, each chunk covers order[first, first + count)
+static std::vector<TileChunk> build_tile_chunks(const std::vector<TileInstanceData>& instances, std::vector<int>& order)
+{
+	// chunk coordinates, std::pair sorts by row first
+	std::map<std::pair<int, int>, std::vector<int>> chunk_instances;
+	for (size_t i = 0; i < instances.size(); i++) {
+		// the translation of the transform is the tile center
+		vec2 grid_position = convert_world_to_grid(vec2(instances[i].transform[2]));
+		int chunk_x = (int)floor(grid_position.x / TILE_CHUNK_SIZE);
+		int chunk_y = (int)floor(grid_position.y / TILE_CHUNK_SIZE);
+		chunk_instances[{ chunk_y, chunk_x }].push_back((int)i);
+	}
+
+	std::vector<TileChunk> chunks;
+	order.clear();
+	for (auto& pair : chunk_instances) {
+		TileChunk chunk;
+		chunk.chunk_position = { pair.first.second, pair.first.first };
+		chunk.first = order.size();
+		chunk.count = pair.second.size();
+		chunk.min_position = vec2(FLT_MAX);
+		chunk.max_position = vec2(-FLT_MAX);
+		for (int i : pair.second) {
+			const mat3& transform = instances[i].transform;
+			vec2 half_size = abs(vec2(transform[0].x, transform[1].y)) / 2.f;
+			chunk.min_position = min(chunk.min_position, vec2(transform[2]) - half_size);
+			chunk.max_position = max(chunk.max_position, vec2(transform[2]) + half_size);
+			order.push_back(i);
+		}
+		chunks.push_back(std::move(chunk));
+	}
+	return chunks;
+}
+
 void RenderSystem::set_tiles_instance_buffer() {
+	std::vector<int> order;
+	tile_chunks = build_tile_chunks(registry.tileInstanceData.components, order);
+	std::vector<TileInstanceData> sorted_instances;
+	sorted_instances.reserve(order.size());
+	for (int i : order) {
+		sorted_instances.push_back(registry.tileInstanceData.components[i]);
+	}
+
 	glUseProgram(tile_instance_program);
 	glBindVertexArray(tiles_instance_VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, tiles_instance_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(TileInstanceData) * registry.tileInstanceData.size(), registry.tileInstanceData.components.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(TileInstanceData) * sorted_instances.size(), sorted_instances.data(), GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 }
@@ -1126,14 +1696,11 @@ void RenderSystem::drawTilesInstanced(const glm::mat3& projection, const glm::ma
 	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 
 	// Setting vertex and index buffers
-	glUseProgram(tile_instance_program);
-	glBindVertexArray(tiles_instance_VAO);
+	gl_state.use_program(tile_instance_program);
+	gl_state.bind_vertex_array(tiles_instance_VAO);
 	glBindBuffer(GL_ARRAY_BUFFER, tiles_instance_VBO);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
-
-	// Enabling and binding texture to slot 0
-	glActiveTexture(GL_TEXTURE0);
+	gl_state.count(2);
 	gl_has_errors();
 
 	GLuint texture_id;
@@ -1149,71 +1716,85 @@ void RenderSystem::drawTilesInstanced(const glm::mat3& projection, const glm::ma
 	else {
 		texture_id = texture_gl_handles[(GLuint)TEXTURE_ASSET_ID::TILES_ATLAS_SANDSTONE];
 	}
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	gl_state.bind_texture(texture_id);
 	gl_has_errors();
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(tile_instance_program, "fcolor");
 	//const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float*)&color);
+	gl_state.set_uniform(tile_instance_locations.fcolor, vec3(1));
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-	GLsizei num_indices = size / sizeof(uint16_t);
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
-	GLuint view_loc = glGetUniformLocation(currProgram, "view");
-	glUniformMatrix3fv(view_loc, 1, GL_FALSE, (float*)&view);
+	GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+
+	gl_state.set_uniform(tile_instance_locations.projection, projection);
+	gl_state.set_uniform(tile_instance_locations.view, view);
 	gl_has_errors();
 
-	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, 0, registry.tileInstanceData.size());
+	// Chunks in view that are next to each other in the buffer are drawn together
+	int run_first = 0;
+	int run_count = 0;
+	auto draw_run = [&]() {
+		if (run_count == 0) return;
+		setTileInstanceAttributes(run_first * sizeof(TileInstanceData));
+		glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, 0, run_count);
+		// four attribute pointers and the draw
+		gl_state.count(5);
+		draw_calls++;
+		gl_has_errors();
+	};
+	for (const TileChunk& chunk : tile_chunks) {
+		if (!camera.isInCameraView(chunk.min_position, chunk.max_position)) continue;
+		if (run_count > 0 && run_first + run_count == chunk.first) {
+			run_count += chunk.count;
+			continue;
+		}
+		draw_run();
+		run_first = chunk.first;
+		run_count = chunk.count;
+	}
+	draw_run();
+
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	gl_state.count(2);
+	gl_state.bind_vertex_array(0);
 	gl_has_errors();
 }
 
 // called once when generating new map
-void RenderSystem::set_visibility_tiles_instance_buffer_max() {
-	glUseProgram(visibility_tile_instance_program);
-	glBindVertexArray(visibility_tile_instance_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, visibility_tile_instance_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(VisibilityTileInstanceData) * registry.visibilityTileInstanceData.size(), registry.visibilityTileInstanceData.components.data(), GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+void RenderSystem::set_fog_texture(const unsigned char* fog_map, ivec2 size) {
+	fog_size = size;
+	glBindTexture(GL_TEXTURE_2D, fog_texture);
+	// rows of one byte texels are not 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size.x, size.y, 0, GL_RED, GL_UNSIGNED_BYTE, fog_map);
+	// back to the default, later uploads expect it
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_has_errors();
 }
 
-// called when visibility map is decreased, we do this instead of glBufferData so don't realloc every time
-void RenderSystem::set_visibility_tiles_instance_buffer() {
-	glUseProgram(visibility_tile_instance_program);
-	glBindVertexArray(visibility_tile_instance_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, visibility_tile_instance_VBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(VisibilityTileInstanceData) * registry.visibilityTileInstanceData.size(), registry.visibilityTileInstanceData.components.data());
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+// called when visibility map is decreased, only the revealed rectangle is uploaded
+void RenderSystem::update_fog_texture(const unsigned char* fog_map, ivec2 min_cell, ivec2 max_cell) {
+	ivec2 size = max_cell - min_cell + 1;
+	glBindTexture(GL_TEXTURE_2D, fog_texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	// the rectangle's rows are fog_size.x apart in fog_map
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, fog_size.x);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, min_cell.x, min_cell.y, size.x, size.y, GL_RED, GL_UNSIGNED_BYTE, fog_map + min_cell.y * fog_size.x + min_cell.x);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_has_errors();
 }
 
-void RenderSystem::drawVisibilityTilesInstanced(const glm::mat3& projection, const glm::mat3& view)
+void RenderSystem::drawFog(const glm::mat3& projection, const glm::mat3& view)
 {
-	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::DEBUG_LINE];
-
-	// Setting vertex and index buffers
-	glUseProgram(visibility_tile_instance_program);
-	glBindVertexArray(visibility_tile_instance_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, visibility_tile_instance_VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	// fog_VAO keeps the sprite vertex and index buffers bound
+	gl_state.use_program(fog_program);
+	gl_state.bind_vertex_array(fog_VAO);
+	gl_state.bind_texture(fog_texture);
 	gl_has_errors();
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(visibility_tile_instance_program, "fcolor");
-	//const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
 	vec3 color;
 	if (map_info.level == MAP_LEVEL::LEVEL3) {
 		color = vec3(52.f / 255.f, 144.f / 255.f, 151.f / 255.f);
@@ -1224,27 +1805,25 @@ void RenderSystem::drawVisibilityTilesInstanced(const glm::mat3& projection, con
 	else {
 		color = vec3(0);
 	}
-	glUniform3fv(color_uloc, 1, (float*)&color);
+	gl_state.set_uniform(fog_locations.fcolor, color);
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-	GLsizei num_indices = size / sizeof(uint16_t);
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
-	GLuint view_loc = glGetUniformLocation(currProgram, "view");
-	glUniformMatrix3fv(view_loc, 1, GL_FALSE, (float*)&view);
+	// the quad spans from the outer edge of the first grid cell to the outer edge of the last one,
+	// so texel centers land on cell centers
+	Transform transform;
+	transform.translate(convert_grid_to_world(vec2(fog_size - 1) / 2.f));
+	transform.scale(vec2(fog_size) * (float)world_tile_size);
+
+	gl_state.set_uniform(fog_locations.transform, transform.mat);
+	gl_state.set_uniform(fog_locations.projection, projection);
+	gl_state.set_uniform(fog_locations.view, view);
 	gl_has_errors();
 
-	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, 0, registry.visibilityTileInstanceData.size());
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	gl_state.count(1);
+	draw_calls++;
+	gl_state.bind_vertex_array(0);
 	gl_has_errors();
 }
 
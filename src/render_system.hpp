@@ -4,6 +4,7 @@
 #include <utility>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
 
@@ -13,6 +14,175 @@
 #include "camera.hpp"
 #include "ui.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "asset_loader.hpp"
+#include "texture_cache.hpp"
+#include "program_cache.hpp"
+#include "mesh_cache.hpp"
+#include "frame_profiler.hpp"
+#include "spatial_grid.hpp"
+
+// Per sprite data for instanced sprite batches
+struct SpriteInstanceData {
+	mat3 transform;
+	vec3 color;
+	vec2 end_pos;
+	vec2 scale;
+	// sub rectangle of the bound texture { u offset, v offset, u size, v size }
+	vec4 uv_rect;
+	// looping sprite sheet { start ms, ms per frame }, the vertex shader advances end_pos.x from the time uniform
+	// ms per frame 0 draws end_pos as is
+	vec2 animation;
+};
+
+// Atlas page size in pixels, clamped to GL_MAX_TEXTURE_SIZE at startup
+const int TEXTURE_ATLAS_SIZE = 4096;
+
+// Width in pixels of the font glyph atlas, its height fits the glyphs of the loaded size
+const int FONT_ATLAS_WIDTH = 512;
+// Glyphs loaded from the font, first 128 ASCII characters
+const int FONT_CHARACTER_COUNT = 128;
+
+// Vertex of a laid out glyph quad, all text of a layer is drawn from one stream
+struct TextVertex {
+	vec2 position;
+	vec2 texcoord;
+	vec4 color; // text color and transparency
+};
+
+// Lowest RenderSystem::set_render_scale
+const float MIN_RENDER_SCALE = 0.5f;
+
+// Side in grid cells of the square chunks tile instances are grouped into
+const int TILE_CHUNK_SIZE = 16;
+
+// Fewest sprites or bullets a draw list worker builds, smaller lists are built on the render thread
+const int DRAW_LIST_MIN_RANGE = 256;
+
+// Tile instances of one chunk of the map, stored contiguously in an instance buffer
+// Chunks outside the camera view are not drawn
+struct TileChunk {
+	ivec2 chunk_position; // chunk coordinates, grid position / TILE_CHUNK_SIZE
+	vec2 min_position; // world space bounds of the chunk's tiles
+	vec2 max_position;
+	int first = 0; // first instance of the chunk in the buffer
+	int count = 0;
+};
+
+// Frames a text layout can go unused before it is dropped from the layout cache
+const int TEXT_LAYOUT_MAX_UNUSED_FRAMES = 60;
+
+// Glyph quads of a string laid out once and reused while the string does not change
+// Positions are centered on the text origin, color and transform are applied per draw
+struct TextLayout {
+	unsigned int font_size;
+	float scale;
+	float line_spacing; // 0 for single line text
+	std::vector<vec4> vertices; // <vec2 pos, vec2 tex>
+	int last_used_frame;
+};
+
+// Uniform and attribute locations of a shader program, resolved once after linking
+// instead of looked up by name on every draw.
+// Names a program does not use stay -1, glUniform* ignores location -1
+struct ProgramLocations {
+	// attributes
+	GLint in_position = -1;
+	GLint in_texcoord = -1;
+	GLint in_color = -1;
+	// uniforms
+	GLint transform = -1;
+	GLint projection = -1;
+	GLint view = -1;
+	GLint view_ui = -1;
+	GLint time = -1;
+	GLint fcolor = -1;
+	GLint end_pos = -1;
+	GLint scale = -1;
+	GLint health_percentage = -1;
+	GLint focus_mode_alpha = -1;
+	GLint invul_timer = -1;
+	GLint strength = -1;
+	GLint darken_screen_factor = -1;
+	GLint bomb_screen_factor = -1;
+
+	void resolve(GLuint program);
+};
+
+// Remembers the bound program, vertex array and texture (unit 0) to skip redundant binds.
+// Counts the GL calls made through it: binds, uniform uploads and draws.
+// Call invalidate() after binding state without it, e.g. during initialization
+class GLStateCache {
+	// no GL object has this name, marks state that has to be set again
+	static const GLuint UNKNOWN = ~0u;
+	GLuint program = UNKNOWN;
+	GLuint vertex_array = UNKNOWN;
+	GLuint texture = UNKNOWN;
+public:
+	// GL calls issued and redundant binds skipped since begin_frame
+	int calls = 0;
+	int skipped = 0;
+
+	void begin_frame();
+	void invalidate();
+
+	void use_program(GLuint program);
+	void bind_vertex_array(GLuint vertex_array);
+	void bind_texture(GLuint texture);
+
+	void set_uniform(GLint location, float value);
+	void set_uniform(GLint location, const vec2& value);
+	void set_uniform(GLint location, const vec3& value);
+	void set_uniform(GLint location, const mat3& value);
+
+	// GL calls made directly, e.g. draws and buffer uploads
+	void count(int amount = 1) { calls += amount; }
+};
+
+// Frames the instance ring buffer keeps in flight, each writes its own segment
+const int INSTANCE_BUFFER_FRAMES = 3;
+// Initial segment size in bytes, grown when a frame needs more
+const size_t INSTANCE_BUFFER_SEGMENT_SIZE = 1 << 20;
+
+// Streaming buffer for per-frame instance data, shared by all instanced passes.
+// Instance data is written straight into mapped memory, there is no intermediate array and no
+// buffer re-specification per draw.
+// With ARB_buffer_storage the buffer stays persistently mapped and a fence per segment stops the
+// CPU from overwriting a segment the GPU still reads. Otherwise each range is mapped unsynchronized
+// and the buffer is orphaned whenever writing wraps back to the first segment.
+class InstanceRingBuffer {
+	GLuint buffer = 0;
+	bool persistent = false;
+	unsigned char* persistent_ptr = nullptr;
+	std::array<GLsync, INSTANCE_BUFFER_FRAMES> fences = {};
+	size_t segment_size = 0;
+	int segment = 0;
+	// next free byte in the current segment and the start of the mapped range
+	size_t offset = 0;
+	size_t mapped_offset = 0;
+
+	void create(size_t segment_size);
+	void release();
+public:
+	// GL calls issued since begin_frame
+	int calls = 0;
+
+	void init();
+	void destroy();
+
+	// Move to the next segment, waits if the GPU is still reading it
+	void begin_frame();
+	// Fence the segment written this frame
+	void end_frame();
+
+	// Memory for up to max_bytes of instance data, only one range can be mapped at a time.
+	// Leaves the buffer bound to GL_ARRAY_BUFFER
+	void* map(size_t max_bytes);
+	// Keeps the first used_bytes written since map, returns their byte offset in the buffer
+	size_t unmap(size_t used_bytes);
+
+	GLuint get_buffer() const { return buffer; }
+	bool is_persistent() const { return persistent; }
+};
 
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
@@ -27,6 +197,14 @@ class RenderSystem {
 	std::array<GLuint, texture_count> texture_gl_handles;
 	std::array<ivec2, texture_count> texture_dimensions;
 
+	// Texture atlases
+	// Small textures are also packed into a few large atlas pages at startup so sprite batches can span textures.
+	// The standalone textures above stay for effects drawn one by one.
+	// texture_atlas_page is -1 for textures too large to pack
+	std::vector<GLuint> atlas_gl_handles;
+	std::array<int, texture_count> texture_atlas_page;
+	std::array<vec4, texture_count> texture_atlas_rect; // { u offset, v offset, u size, v size }
+
 	// Make sure these paths remain in sync with the associated enumerators.
 	// Associated id with .obj path
 	const std::vector < std::pair<GEOMETRY_BUFFER_ID, std::string>> mesh_paths =
@@ -190,16 +368,43 @@ class RenderSystem {
 
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
+	// number of uint16_t indices in each index buffer
+	std::array<GLsizei, geometry_count> index_counts;
 	std::array<Mesh, geometry_count> meshes;
 
+	// Assets decoded on AssetLoader workers, uploaded by init as each one finishes
+	struct DecodedTexture {
+		const unsigned char* pixels = nullptr; // owned by texture_cache
+		ivec2 dimensions = { 0, 0 };
+	};
+	TextureCache texture_cache;
+	// binaries of the linked shader programs, kept until initFont
+	ProgramCache program_cache;
+	std::vector<std::future<DecodedTexture>> texture_jobs;
+	MeshCache mesh_cache;
+	// load results of mesh_paths into meshes, same order
+	std::vector<std::future<bool>> mesh_jobs;
+	// workers of load_assets, or own_workers
+	AssetLoader* workers = nullptr;
+	std::unique_ptr<AssetLoader> own_workers;
+
 public:
+	// Start decoding textures and parsing meshes on asset_loader's workers, no GL calls
+	// Call before init so decoding overlaps window creation
+	// asset_loader must outlive the renderer, its workers also build the draw lists
+	void load_assets(AssetLoader& asset_loader);
+
 	// Initialize the window
-	bool init(GLFWwindow* window);
+	// Assets are decoded on an AssetLoader of the renderer's own if load_assets was not called
+	// is_headless renders finished frames into an offscreen framebuffer instead of the hidden window
+	bool init(GLFWwindow* window, bool is_headless = false);
 
 	template <class T>
 	void bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices);
 
 	void initializeGlTextures();
+	// Pack textures small enough into atlas pages, texture_data holds the decoded RGBA pixels of every texture
+	void initializeTextureAtlases(const std::vector<const unsigned char*>& texture_data);
 
 	void initializeGlEffects();
 
@@ -211,6 +416,7 @@ public:
 	// The draw loop first renders to this texture, then it is used for the wind
 	// shader
 	bool initScreenTexture();
+	bool initOutputFramebuffer();
 
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
@@ -226,62 +432,195 @@ public:
 	Camera camera;
 	UI ui;
 
+	// CPU and GPU time of each stage of draw, shown with the fps overlay
+	FrameProfiler profiler;
+
 	// font initialization
 	bool initFont(GLFWwindow* window, const std::string& font_filename, unsigned int font_default_size);
 
 	// extra parameter in_world specifies whether or not text should be world or screen coordinate
+	// Text is laid out into the world or screen layer and drawn by the next flushText
 	void renderText(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat3& trans, bool in_world = false, float transparency_rate = 1);
 
 	// tiles instancing
 	// called once when generating new map
 	void set_tiles_instance_buffer();
-	// called when visibility map is decreased
-	void set_visibility_tiles_instance_buffer();
-	// called once when generating new map
-	void set_visibility_tiles_instance_buffer_max();
+
+	// fog of war, one texel of opacity per grid cell, see VisibilitySystem::fog_map
+	// called once when generating new map, size is the map size in grid cells
+	void set_fog_texture(const unsigned char* fog_map, ivec2 size);
+	// called when visibility map is decreased, uploads the cells from min_cell to max_cell (inclusive)
+	void update_fog_texture(const unsigned char* fog_map, ivec2 min_cell, ivec2 max_cell);
 	// get sprite location of tile name sandstone atlas
 	vec4 get_spriteloc(TILE_NAME tile_name);
 	// if is_close true, switch to closed texture, otherwise open texture
 	void switch_door_texture(Entity door_entity, bool is_close);
+
+	// number of draw calls and GL calls issued by the last completed frame
+	int get_draw_calls() { return last_frame_draw_calls; }
+	int get_gl_calls() { return last_frame_gl_calls; }
+	// render requests visited by camera culling and drawn by the last completed frame
+	int get_sprites_considered() { return last_frame_sprites_considered; }
+	int get_sprites_drawn() { return last_frame_sprites_drawn; }
+
+	// Write the next presented frame to path as PNG, e.g. for image-diff regression tests
+	void request_snapshot(const std::string& path) { snapshot_path = path; }
+
+	// Fraction of the window resolution the scene is rendered at, upscaled by drawToScreen
+	// Clamped to [MIN_RENDER_SCALE, 1], lower trades resolution for fill rate, e.g. on software rasterizers
+	void set_render_scale(float scale);
 private:
 	// Internal drawing functions for each entity type
 	void drawTexturedMesh(Entity entity, const mat3& projection, const mat3& view, const mat3& view_ui);
-	void drawBulletsInstanced(const std::vector<Entity>& entities, const glm::mat3& projection, const glm::mat3& view);
+	// amount transforms written to instance_buffer at instance_offset
+	void drawBulletsInstanced(size_t instance_offset, int amount, const glm::mat3& projection, const glm::mat3& view);
 	void drawTilesInstanced(const glm::mat3& projection, const glm::mat3& view);
-	void drawVisibilityTilesInstanced(const glm::mat3& projection, const glm::mat3& view);
+	void drawFog(const glm::mat3& projection, const glm::mat3& view);
 	void drawToScreen();
+	// Reads the finished frame back from output_frame_buffer and writes it to snapshot_path
+	void writeSnapshot();
+	std::string snapshot_path;
+	// Draws the queued world text, then the queued screen text, one draw call per layer
+	// Call before drawing anything that should cover the text queued so far
+	void flushText();
+	void drawTextLayer(std::vector<TextVertex>& vertices, const mat3& view);
 
 	// Window handle
 	GLFWwindow* window;
 
+	// Framebuffer finished frames are drawn to, 0 (the window) unless headless
+	// The back buffer of a hidden window fails the pixel ownership test, so reading it back is undefined
+	bool is_headless = false;
+	GLuint output_frame_buffer = 0;
+	GLuint output_render_buffer_color = 0;
+	GLuint output_render_buffer_depth = 0;
+
 	// Screen texture handles
+	// The scene is only drawn into the screen texture while is_composited, see draw
 	GLuint frame_buffer;
 	GLuint off_screen_render_buffer_color;
 	GLuint off_screen_render_buffer_depth;
+	ivec2 screen_texture_size = { 0, 0 };
+	void resizeScreenTexture(ivec2 size);
+	float render_scale = 1.f;
+	bool is_composited = true;
 
 	// Enemy bullet instancing
 	void initializeEnemyBulletInstance();
 	GLuint enemy_bullet_instance_program;
 	GLuint enemy_bullet_instance_VAO;
-	GLuint enemy_bullet_instance_VBO;
+	GLint enemy_bullet_transform_loc;
 
 	// Tile instancing
+	// Instances are sorted by TileChunk, only chunks in camera view are drawn
 	void initializeTileInstance();
+	void setTileInstanceAttributes(size_t offset);
 	GLuint tile_instance_program;
 	GLuint tiles_instance_VAO;
 	GLuint tiles_instance_VBO;
-
-	// Visibility tile instancing
-	void initializeVisibilityTileInstance();
-	GLuint visibility_tile_instance_program;
-	GLuint visibility_tile_instance_VAO;
-	GLuint visibility_tile_instance_VBO;
+	GLint tile_sprite_location_loc;
+	GLint tile_transform_loc;
+	std::vector<TileChunk> tile_chunks;
+
+	// Fog of war
+	// A single quad over the map samples the fog texture with linear filtering
+	void initializeFog();
+	GLuint fog_program;
+	GLuint fog_VAO;
+	GLuint fog_texture;
+	ivec2 fog_size = { 0, 0 };
+
+	// Per-frame instance data of enemy bullets and sprite batches
+	InstanceRingBuffer instance_buffer;
+	// transforms of visible enemy bullets, built by the workers before being copied into instance_buffer
+	// range r of the parallel_for wrote bullet_ranges[r].y transforms from bullet_ranges[r].x
+	std::vector<mat3> bullet_transforms;
+	std::vector<ivec2> bullet_ranges;
+
+	// Sprite batching
+	// TEXTURED sprites are queued per pass, sorted by texture and drawn with one instanced draw per texture
+	// order is the submission index, it keeps the overlap order of sprites sharing a texture
+	// sort_key is RenderRequest::sort_key, sprites with a lower key are drawn first whatever their texture
+	struct SpriteBatchItem {
+		int sort_key;
+		GLuint texture;
+		int order;
+		SpriteInstanceData instance;
+	};
+	void initializeSpriteInstance();
+	void setSpriteInstanceAttributes(size_t offset);
+	// Queues entities in order, their instance data is built on the workers
+	// Entities that can not be batched are appended to unbatched, they should be drawn with drawTexturedMesh
+	void queueSprites(const std::vector<Entity>& entities, std::vector<Entity>& unbatched);
+	// Fills all of item but order from entity's components, returns false if entity can not be batched
+	// Only reads the registry, called from the workers
+	bool buildSpriteItem(Entity entity, SpriteBatchItem& item);
+	// Appends every live particle in view to sprite_batch, see ParticleSystem
+	void queueParticles();
+	// Atlas page of a packed texture, otherwise its own texture
+	GLuint getSpriteTexture(TEXTURE_ASSET_ID id) const;
+	void flushSprites(const mat3& projection, const mat3& view);
+	std::vector<SpriteBatchItem> sprite_batch;
+	// per entity of the queueSprites call, char as vector<bool> elements can not be written concurrently
+	std::vector<char> sprite_is_batched;
+	GLuint sprite_instance_program;
+	GLuint sprite_instance_VAO;
+	GLint sprite_transform_loc;
+	GLint sprite_color_loc;
+	GLint sprite_end_pos_loc;
+	GLint sprite_scale_loc;
+	GLint sprite_uv_rect_loc;
+	GLint sprite_animation_loc;
+
+	// Camera culling of render requests
+	// Walls and doors never move, they are kept in a grid and only the cells in camera view are visited
+	// Every other render request of the WORLD, WORLD_UI and BOSS_HEALTH_BAR layers is visited each frame
+	// Entities are sorted into one of the two lists once, by updateSpriteCulling, when they are first drawn
+	void updateSpriteCulling();
+	SpatialGrid static_sprite_grid;
+	std::vector<Entity> static_sprites;
+	std::vector<Entity> dynamic_sprites;
+	// entities with a lower id are already sorted into static_sprites or dynamic_sprites
+	unsigned int next_unsorted_entity = 0;
+	std::vector<unsigned int> culling_candidates;
+	int sprites_considered = 0;
+	int sprites_drawn = 0;
+	int last_frame_sprites_considered = 0;
+	int last_frame_sprites_drawn = 0;
+
+	// Draw calls counted during the current frame
+	int draw_calls = 0;
+	int last_frame_draw_calls = 0;
+	int last_frame_gl_calls = 0;
+
+	// Cached locations, see ProgramLocations
+	std::array<ProgramLocations, effect_count> effect_locations;
+	ProgramLocations enemy_bullet_instance_locations;
+	ProgramLocations tile_instance_locations;
+	ProgramLocations fog_locations;
+	ProgramLocations sprite_instance_locations;
+	ProgramLocations font_locations;
+	GLStateCache gl_state;
 
 	// Fonts
-	std::map<char, Character> m_ftCharacters;
+	// glyphs live in a single atlas texture, laid out glyph quads are streamed through the instance buffer
+	std::array<Character, FONT_CHARACTER_COUNT> m_ftCharacters;
 	GLuint m_font_shaderProgram;
 	GLuint m_font_VAO;
-	GLuint m_font_VBO;
+	GLuint m_font_atlas = 0;
+	unsigned int font_size = 0;
+	std::vector<TextVertex> text_world_vertices;
+	std::vector<TextVertex> text_ui_vertices;
+
+	// Text layout cache, keyed by string then by font size, scale and line spacing
+	// Lookups by the string do not allocate, layouts are built only for new strings
+	std::unordered_map<std::string, std::vector<TextLayout>> text_layouts;
+	int text_layout_frame = 0;
+	const TextLayout& getTextLayout(const std::string& text, float scale, float line_spacing);
+	void layoutTextLine(const std::string& line, float scale, float y_offset, std::vector<vec4>& vertices);
+	void queueTextLayout(const TextLayout& layout, float x, float y, const glm::vec3& color, const glm::mat3& trans, bool in_world, float transparency_rate);
+	// drop layouts of strings no longer drawn, e.g. old FPS values
+	void evictTextLayouts();
 	GLuint dummyVAO;
 
 	glm::mat4 trans = glm::mat4(1.0f);
@@ -289,32 +628,33 @@ private:
 	const char* fontVertexShaderSource =
 		"#version 330 core\n"
 		"layout(location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>\n"
+		"layout(location = 1) in vec4 in_color; // <vec3 color, float transparency>\n"
 		"out vec2 TexCoords; \n"
+		"out vec4 TextColor; \n"
 		"\n"
 		"uniform mat3 projection; \n"
-		"uniform mat3 transform;\n"
 		"uniform mat3 view;\n"
 		"\n"
 		"void main()\n"
 		"{\n"
-		"    gl_Position = vec4(projection * view * transform * vec3(vertex.xy, 1.0), 1.0); \n"
+		"    gl_Position = vec4(projection * view * vec3(vertex.xy, 1.0), 1.0); \n"
 		"    TexCoords = vertex.zw; \n"
+		"    TextColor = in_color; \n"
 		"}\0";
 
 	const char* fontFragmentShaderSource =
 		"#version 330 core\n"
 		"in vec2 TexCoords;\n"
+		"in vec4 TextColor;\n"
 		"out vec4 color;\n"
 		"\n"
 		"uniform sampler2D text;\n"
-		"uniform vec3 textColor;\n"
-		"uniform float transparency;\n"
 		"\n"
 		"void main()\n"
 		"{\n"
 		"    vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);\n"
-		"    vec4 finalColor = vec4(textColor, 1.0) * sampled;\n"
-		"    finalColor.a *= transparency; // Adjust alpha with transparency\n"
+		"    vec4 finalColor = vec4(TextColor.rgb, 1.0) * sampled;\n"
+		"    finalColor.a *= TextColor.a; // Adjust alpha with transparency\n"
 		"    color = finalColor;\n"
 		"}\n";
 
@@ -325,5 +665,8 @@ private:
 	void render_text_newline(const std::string& text, float x, float y, float scale, const glm::vec3& color, const glm::mat3& trans, bool in_world, float padding_y = 25.f, float transparency = 1.f);
 };
 
+// Compiles and links a program, or loads its binary from program_cache if the sources are unchanged
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program, ProgramCache* program_cache = nullptr);
+bool loadEffectFromSource(
+	const std::string& vs_source, const std::string& fs_source, GLuint& out_program, ProgramCache* program_cache = nullptr);
@@ -2,14 +2,17 @@
 #include "render_system.hpp"
 
 #include <array>
+#include <chrono>
 #include <fstream>
 
 #include "../ext/stb_image/stb_image.h"
+#include "texture_cache.hpp"
 
 // This creates circular header inclusion, that is quite bad.
 #include "tiny_ecs_registry.hpp"
 
 // stlib
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <glm/gtc/type_ptr.hpp>
@@ -21,9 +24,10 @@
 #include<iterator>
 
 // World initialization
-bool RenderSystem::init(GLFWwindow* window_arg)
+bool RenderSystem::init(GLFWwindow* window_arg, bool is_headless)
 {
 	this->window = window_arg;
+	this->is_headless = is_headless;
 
 	glfwMakeContextCurrent(window);
 	glfwSwapInterval(1); // vsync
@@ -62,40 +66,145 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 
 	gl_has_errors();
 
+	if (texture_jobs.empty()) {
+		own_workers = std::make_unique<AssetLoader>();
+		load_assets(*own_workers);
+	}
+
 	initScreenTexture();
+	initOutputFramebuffer();
 	initializeGlTextures();
+	program_cache.load(program_cache_path());
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
 
+	instance_buffer.init();
 	initializeEnemyBulletInstance();
 	initializeTileInstance();
-	initializeVisibilityTileInstance();
+	initializeFog();
+	initializeSpriteInstance();
+
+	// the font program is added by initFont, which saves again
+	program_cache.save();
+	printf("Linked %d shader programs (%s program cache: %d cached, %d compiled)\n", program_cache.hits + program_cache.misses,
+		!program_cache.is_supported() ? "no" : program_cache.misses > 0 ? "cold" : "warm", program_cache.hits, program_cache.misses);
 
 	return true;
 }
 
+void RenderSystem::load_assets(AssetLoader& asset_loader)
+{
+	workers = &asset_loader;
+	texture_cache.load(texture_cache_path());
+	texture_jobs.clear();
+	for (const std::string& path : texture_paths)
+	{
+		// texture_paths lives as long as the renderer
+		texture_jobs.push_back(asset_loader.submit([this, &path]() {
+			DecodedTexture decoded;
+			decoded.pixels = texture_cache.get(path, decoded.dimensions);
+			return decoded;
+		}));
+	}
+
+	// each job only writes its own mesh, only new or changed OBJ files are parsed
+	mesh_cache.load(mesh_cache_path());
+	mesh_jobs.clear();
+	for (const auto& mesh_path : mesh_paths)
+	{
+		Mesh& mesh = meshes[(int)mesh_path.first];
+		const std::string& path = mesh_path.second;
+		mesh_jobs.push_back(asset_loader.submit([this, &mesh, &path]() {
+			return mesh_cache.get(path, mesh);
+		}));
+	}
+}
+
+// Persistent mapping needs glBufferStorage, core in OpenGL 4.4 and otherwise ARB_buffer_storage
+static bool has_buffer_storage()
+{
+	if (glBufferStorage == nullptr) return false;
+	if (gl3w_is_supported(4, 4)) return true;
+
+	GLint extension_count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+	for (GLint i = 0; i < extension_count; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension != nullptr && strcmp(extension, "GL_ARB_buffer_storage") == 0) return true;
+	}
+	return false;
+}
+
+void InstanceRingBuffer::init()
+{
+	persistent = has_buffer_storage();
+	create(INSTANCE_BUFFER_SEGMENT_SIZE);
+	printf("Instance buffer: %s, %zu KB per frame\n", persistent ? "persistent mapping" : "orphaning", segment_size / 1024);
+}
+
+void InstanceRingBuffer::create(size_t segment_size)
+{
+	this->segment_size = segment_size;
+	segment = 0;
+	offset = 0;
+	const size_t size = segment_size * INSTANCE_BUFFER_FRAMES;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (persistent) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		persistent_ptr = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+		assert(persistent_ptr != nullptr);
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	}
+	gl_has_errors();
+}
+
+// Draws already issued keep reading the old storage, GL frees it once they are done
+void InstanceRingBuffer::release()
+{
+	for (GLsync& fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (persistent_ptr) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		persistent_ptr = nullptr;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	gl_has_errors();
+}
+
+void InstanceRingBuffer::destroy()
+{
+	if (buffer) release();
+}
+
 // Adapted from: https://learnopengl.com/Advanced-OpenGL/Instancing
 void RenderSystem::initializeEnemyBulletInstance() {
-	enemy_bullet_instance_program = glCreateProgram();
-
 	// Load shaders
 	std::string path = shader_path("textured_instance");
 
 	const std::string vertex_shader_name = path + ".vs.glsl";
 	const std::string fragment_shader_name = path + ".fs.glsl";
 
-	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, enemy_bullet_instance_program);
+	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, enemy_bullet_instance_program, &program_cache);
 	assert(is_valid && (GLuint)enemy_bullet_instance_program != 0);
+	enemy_bullet_instance_locations.resolve(enemy_bullet_instance_program);
 
 	glUseProgram(enemy_bullet_instance_program);
 	gl_has_errors();
 
-	glGenBuffers(1, &enemy_bullet_instance_VBO);
 	glGenVertexArrays(1, &enemy_bullet_instance_VAO);
 	gl_has_errors();
 
-	// Instance vbo
-	glBindBuffer(GL_ARRAY_BUFFER, enemy_bullet_instance_VBO);
+	// Instance transforms are streamed through the instance ring buffer
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.get_buffer());
 	gl_has_errors();
 
 	// Instance vao
@@ -104,6 +213,7 @@ void RenderSystem::initializeEnemyBulletInstance() {
 
 	int loc = glGetAttribLocation(enemy_bullet_instance_program, "in_transform");
 	assert(loc >= 0);
+	enemy_bullet_transform_loc = loc;
 	gl_has_errors();
 	int loc1 = loc;
 	int loc2 = loc + 1;
@@ -128,15 +238,24 @@ void RenderSystem::initializeEnemyBulletInstance() {
 
 void RenderSystem::initializeGlTextures()
 {
+	auto start = std::chrono::steady_clock::now();
 	glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 
-	for (uint i = 0; i < texture_paths.size(); i++)
+	// decoded pixels come from the on-disk cache, only new or changed textures are decoded
+	// pixels are owned by the cache and kept until the atlases are packed
+	// textures are uploaded in the order their decoding finishes
+	std::vector<const unsigned char*> texture_data(texture_paths.size(), nullptr);
+	std::vector<bool> is_uploaded(texture_paths.size(), false);
+	for (uint uploaded = 0; uploaded < texture_paths.size(); uploaded++)
 	{
+		int i = wait_any(texture_jobs, is_uploaded);
+		is_uploaded[i] = true;
 		const std::string& path = texture_paths[i];
 		ivec2& dimensions = texture_dimensions[i];
 
-		stbi_uc* data;
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+		DecodedTexture decoded = texture_jobs[i].get();
+		const unsigned char* data = decoded.pixels;
+		dimensions = decoded.dimensions;
 
 		if (data == NULL)
 		{
@@ -149,9 +268,117 @@ void RenderSystem::initializeGlTextures()
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		gl_has_errors();
-		stbi_image_free(data);
+		texture_data[i] = data;
+	}
+	gl_has_errors();
+
+	texture_jobs.clear();
+
+	initializeTextureAtlases(texture_data);
+	texture_cache.save();
+
+	// a cold start decoded at least one texture
+	// decoding started in load_assets, this is the time spent waiting for it and uploading
+	float elapsed_ms = (float)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000;
+	printf("Uploaded %d textures in %.1f ms (%s texture cache: %d cached, %d decoded)\n", texture_count, elapsed_ms,
+		texture_cache.misses > 0 ? "cold" : "warm", texture_cache.hits, texture_cache.misses);
+	texture_cache.clear();
+}
+
+// Shelf packing: textures sorted by height are placed left to right in rows,
+// a new row starts when the current one is full, a new page when the rows are full
+void RenderSystem::initializeTextureAtlases(const std::vector<const unsigned char*>& texture_data)
+{
+	// empty space around each texture so nearest sampling at the edges does not pick up a neighbour
+	const int padding = 2;
+
+	GLint max_texture_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	const int atlas_size = min(TEXTURE_ATLAS_SIZE, (int)max_texture_size);
+	// larger textures (e.g. portraits and long animation strips) would leave most of a page empty
+	const int max_packed_size = atlas_size / 2;
+
+	std::vector<int> packed_ids;
+	for (int i = 0; i < texture_count; i++)
+	{
+		texture_atlas_page[i] = -1;
+		texture_atlas_rect[i] = vec4(0.f, 0.f, 1.f, 1.f);
+		if (texture_dimensions[i].x <= max_packed_size && texture_dimensions[i].y <= max_packed_size)
+		{
+			packed_ids.push_back(i);
+		}
+	}
+	std::sort(packed_ids.begin(), packed_ids.end(), [&](int a, int b) {
+		return texture_dimensions[a].y > texture_dimensions[b].y;
+	});
+
+	// Place every texture, pages are only created once their content is known
+	std::vector<ivec2> texture_offsets(texture_count);
+	int page_count = packed_ids.size() > 0 ? 1 : 0;
+	ivec2 cursor = { 0, 0 };
+	int row_height = 0;
+	for (int id : packed_ids)
+	{
+		ivec2 size = texture_dimensions[id] + padding;
+		// next row
+		if (cursor.x + size.x > atlas_size)
+		{
+			cursor = { 0, cursor.y + row_height };
+			row_height = 0;
+		}
+		// next page
+		if (cursor.y + size.y > atlas_size)
+		{
+			page_count++;
+			cursor = { 0, 0 };
+			row_height = 0;
+		}
+		texture_offsets[id] = cursor;
+		texture_atlas_page[id] = page_count - 1;
+		texture_atlas_rect[id] = vec4((float)cursor.x / atlas_size, (float)cursor.y / atlas_size,
+			(float)texture_dimensions[id].x / atlas_size, (float)texture_dimensions[id].y / atlas_size);
+		cursor.x += size.x;
+		row_height = max(row_height, size.y);
+	}
+
+	atlas_gl_handles.resize(page_count);
+	if (page_count == 0) return;
+	glGenTextures(page_count, atlas_gl_handles.data());
+
+	// Pages are cleared to transparent through a framebuffer instead of uploading a page of zeros
+	GLuint clear_frame_buffer;
+	glGenFramebuffers(1, &clear_frame_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, clear_frame_buffer);
+	glClearColor(0.f, 0.f, 0.f, 0.f);
+	for (GLuint atlas : atlas_gl_handles)
+	{
+		glBindTexture(GL_TEXTURE_2D, atlas);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas_size, atlas_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas, 0);
+		glViewport(0, 0, atlas_size, atlas_size);
+		glClear(GL_COLOR_BUFFER_BIT);
+		gl_has_errors();
 	}
+	// init expects the screen frame buffer to stay bound
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	glDeleteFramebuffers(1, &clear_frame_buffer);
 	gl_has_errors();
+
+	// rows of decoded textures are tightly packed RGBA
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (int id : packed_ids)
+	{
+		glBindTexture(GL_TEXTURE_2D, atlas_gl_handles[texture_atlas_page[id]]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, texture_offsets[id].x, texture_offsets[id].y,
+			texture_dimensions[id].x, texture_dimensions[id].y, GL_RGBA, GL_UNSIGNED_BYTE, texture_data[id]);
+		gl_has_errors();
+	}
+
+	printf("Packed %d of %d textures into %d atlas pages of %dx%d\n", (int)packed_ids.size(), texture_count, page_count, atlas_size, atlas_size);
 }
 
 void RenderSystem::initializeGlEffects()
@@ -161,11 +388,35 @@ void RenderSystem::initializeGlEffects()
 		const std::string vertex_shader_name = effect_paths[i] + ".vs.glsl";
 		const std::string fragment_shader_name = effect_paths[i] + ".fs.glsl";
 
-		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
+		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i], &program_cache);
 		assert(is_valid && (GLuint)effects[i] != 0);
+		effect_locations[i].resolve(effects[i]);
 	}
 }
 
+void ProgramLocations::resolve(GLuint program)
+{
+	in_position = glGetAttribLocation(program, "in_position");
+	in_texcoord = glGetAttribLocation(program, "in_texcoord");
+	in_color = glGetAttribLocation(program, "in_color");
+
+	transform = glGetUniformLocation(program, "transform");
+	projection = glGetUniformLocation(program, "projection");
+	view = glGetUniformLocation(program, "view");
+	view_ui = glGetUniformLocation(program, "view_ui");
+	time = glGetUniformLocation(program, "time");
+	fcolor = glGetUniformLocation(program, "fcolor");
+	end_pos = glGetUniformLocation(program, "end_pos");
+	scale = glGetUniformLocation(program, "scale");
+	health_percentage = glGetUniformLocation(program, "health_percentage");
+	focus_mode_alpha = glGetUniformLocation(program, "focus_mode_alpha");
+	invul_timer = glGetUniformLocation(program, "invul_timer");
+	strength = glGetUniformLocation(program, "strength");
+	darken_screen_factor = glGetUniformLocation(program, "darken_screen_factor");
+	bomb_screen_factor = glGetUniformLocation(program, "bomb_screen_factor");
+	gl_has_errors();
+}
+
 
 
 // One could merge the following two functions as a template function...
@@ -180,78 +431,33 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)gid]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	index_counts[(uint)gid] = (GLsizei)indices.size();
 	gl_has_errors();
 }
 
-bool is_leftturn(const vec3& p, const vec3& q, const vec3& r) {
-	float val = (q.y - p.y) * (r.x - q.x) - (q.x - p.x) * (r.y - q.y);
-	return (val > 0);
-}
-
-float square_dist(const vec3& p1, const vec3& p2) {
-	return (p1.x - p2.x) * (p1.x - p2.x) + (p1.y - p2.y) * (p1.y - p2.y);
-}
-
-
-vec3 p0;
-bool compare_angle(const ColoredVertex& v1, const ColoredVertex& v2) {
-	vec3 p1 = v1.position;
-	vec3 p2 = v2.position;
-	bool isLeft = is_leftturn(p0, p1, p2);
-	if (isLeft) {
-		return true;
-	}
-	else if (!isLeft && !is_leftturn(p0, p2, p1)) {
-		return square_dist(p0, p1) < square_dist(p0, p2);
-	}
-	return false;
-}
-
 void RenderSystem::initializeGlMeshes()
 {
 	for (uint i = 0; i < mesh_paths.size(); i++)
 	{
 		// Initialize meshes
+		// loaded by the job started in load_assets, with the convex hull and edges from the mesh cache
 		GEOMETRY_BUFFER_ID geom_index = mesh_paths[i].first;
-		std::string name = mesh_paths[i].second;
-		Mesh::loadFromOBJFile(name,
-			meshes[(int)geom_index].vertices,
-			meshes[(int)geom_index].vertex_indices,
-			meshes[(int)geom_index].original_size);
+		if (!mesh_jobs[i].get())
+		{
+			// bound as an empty mesh, nothing is drawn and nothing collides with it
+			fprintf(stderr, "Could not load the file %s.\n", mesh_paths[i].second.c_str());
+			assert(false);
+		}
 
 		bindVBOandIBO(geom_index,
 			meshes[(int)geom_index].vertices,
 			meshes[(int)geom_index].vertex_indices);
-
-		std::vector<ColoredVertex> colored_vertices = meshes[(int)geom_index].vertices;
-		std::vector<ColoredVertex> ordered_vertices;
-		std::copy(colored_vertices.begin(), colored_vertices.end(), std::back_inserter(ordered_vertices));
-
-		// Graham's Scan algorithm for finding convex hulls in counter-clockwise order. Reference CPSC 420: Advanced Algorithms
-		int n = ordered_vertices.size(), lowest_y = 0;
-		for (int i = 1; i < n; i++) {
-			if ((ordered_vertices[i].position.y < ordered_vertices[lowest_y].position.y) || (ordered_vertices[i].position.y == ordered_vertices[lowest_y].position.y && ordered_vertices[i].position.x < ordered_vertices[lowest_y].position.x))
-				lowest_y = i;
-		}
-		std::swap(ordered_vertices[0], ordered_vertices[lowest_y]);
-
-		p0 = ordered_vertices[0].position;
-		std::sort(ordered_vertices.begin() + 1, ordered_vertices.end(), compare_angle);
-		std::vector<vec3> stack;
-		stack.push_back(ordered_vertices[0].position);
-		stack.push_back(ordered_vertices[1].position);
-		stack.push_back(ordered_vertices[2].position);
-
-		for (int i = 3; i < n; i++) {
-			while (stack.size() > 1 && !is_leftturn(*(stack.end() - 2), stack.back(), ordered_vertices[i].position))
-				stack.pop_back();
-			stack.push_back(ordered_vertices[i].position);
-		}
-		meshes[(int)geom_index].ordered_vertices = stack;
-		//for (vec3& v : stack) {
-		//	std::cout << v.x << "   " << v.y << std::endl;
-		//}
 	}
+	mesh_jobs.clear();
+	mesh_cache.save();
+	printf("Loaded %d meshes (%s mesh cache: %d cached, %d parsed)\n", (int)mesh_paths.size(),
+		mesh_cache.misses > 0 ? "cold" : "warm", mesh_cache.hits, mesh_cache.misses);
+	mesh_cache.clear();
 }
 
 void RenderSystem::initializeGlGeometryBuffers()
@@ -357,8 +563,13 @@ RenderSystem::~RenderSystem()
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
 	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	glDeleteTextures((GLsizei)atlas_gl_handles.size(), atlas_gl_handles.data());
+	glDeleteTextures(1, &m_font_atlas);
+	glDeleteTextures(1, &fog_texture);
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
+	glDeleteRenderbuffers(1, &output_render_buffer_color);
+	glDeleteRenderbuffers(1, &output_render_buffer_depth);
 	gl_has_errors();
 
 	for (uint i = 0; i < effect_count; i++) {
@@ -366,6 +577,9 @@ RenderSystem::~RenderSystem()
 	}
 	// delete allocated resources
 	glDeleteFramebuffers(1, &frame_buffer);
+	glDeleteFramebuffers(1, &output_frame_buffer);
+	instance_buffer.destroy();
+	profiler.destroy();
 	gl_has_errors();
 
 	// remove all entities created by the render system
@@ -396,47 +610,72 @@ bool RenderSystem::initScreenTexture()
 	gl_has_errors();
 
 	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	screen_texture_size = { framebuffer_width, framebuffer_height };
 
 	return true;
 }
 
+bool RenderSystem::initOutputFramebuffer()
+{
+	if (!is_headless) return true;
+
+	int framebuffer_width, framebuffer_height;
+	glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+
+	glGenFramebuffers(1, &output_frame_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, output_frame_buffer);
+	glGenRenderbuffers(1, &output_render_buffer_color);
+	glBindRenderbuffer(GL_RENDERBUFFER, output_render_buffer_color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, framebuffer_width, framebuffer_height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, output_render_buffer_color);
+	glGenRenderbuffers(1, &output_render_buffer_depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, output_render_buffer_depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, framebuffer_width, framebuffer_height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, output_render_buffer_depth);
+	gl_has_errors();
+
+	bool is_complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	assert(is_complete);
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	return is_complete;
+}
+
+void RenderSystem::resizeScreenTexture(ivec2 size)
+{
+	gl_state.bind_texture(off_screen_render_buffer_color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindRenderbuffer(GL_RENDERBUFFER, off_screen_render_buffer_depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, size.x, size.y);
+	gl_state.count(4);
+	gl_has_errors();
+	screen_texture_size = size;
+}
+
+void RenderSystem::set_render_scale(float scale)
+{
+	render_scale = clamp(scale, MIN_RENDER_SCALE, 1.f);
+}
+
 // Font initiation
 // This is adapted from lecture material (Wednesday Feb 28th 2024)
 bool RenderSystem::initFont(GLFWwindow* window, const std::string& font_filename, unsigned int font_default_size) {
 	// font buffer setup
 	glGenVertexArrays(1, &m_font_VAO);
-	glGenBuffers(1, &m_font_VBO);
-
-	// font vertex shader
-	unsigned int font_vertexShader;
-	font_vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(font_vertexShader, 1, &fontVertexShaderSource, NULL);
-	glCompileShader(font_vertexShader);
-
-	// font fragement shader
-	unsigned int font_fragmentShader;
-	font_fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(font_fragmentShader, 1, &fontFragmentShaderSource, NULL);
-	glCompileShader(font_fragmentShader);
-
-	// font shader program
-	m_font_shaderProgram = glCreateProgram();
-	glAttachShader(m_font_shaderProgram, font_vertexShader);
-	glAttachShader(m_font_shaderProgram, font_fragmentShader);
-	glLinkProgram(m_font_shaderProgram);
-
-	// clean up shaders
-	glDeleteShader(font_vertexShader);
-	glDeleteShader(font_fragmentShader);
+
+	// font shader program, cached like the effects
+	bool is_valid = loadEffectFromSource(fontVertexShaderSource, fontFragmentShaderSource, m_font_shaderProgram, &program_cache);
+	assert(is_valid && m_font_shaderProgram != 0);
+	program_cache.save();
 
 	// use our new shader
 	glUseProgram(m_font_shaderProgram);
+	font_locations.resolve(m_font_shaderProgram);
+	assert(font_locations.view > -1);
 
 	// apply projection matrix for font
 	glm::mat3 projection = createProjectionMatrix();
-	GLint project_location = glGetUniformLocation(m_font_shaderProgram, "projection");
-	assert(project_location > -1);
-	glUniformMatrix3fv(project_location, 1, GL_FALSE, glm::value_ptr(projection));
+	assert(font_locations.projection > -1);
+	glUniformMatrix3fv(font_locations.projection, 1, GL_FALSE, glm::value_ptr(projection));
 
 	// init FreeType fonts
 	FT_Library ft;
@@ -455,13 +694,26 @@ bool RenderSystem::initFont(GLFWwindow* window, const std::string& font_filename
 
 	// extract a default size
 	FT_Set_Pixel_Sizes(face, 0, font_default_size);
+	font_size = font_default_size;
+	// layouts hold uv rects of the previous atlas
+	text_layouts.clear();
 
 	// disable byte-alignment restriction in OpenGL
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
 	// load each of the chars - note only first 128 ASCII chars
-	for (unsigned char c = 0; c < 128; c++)
+	// glyphs are packed into rows of the font atlas, 1 pixel apart so nearest sampling never bleeds
+	const int GLYPH_PADDING = 1;
+	std::array<std::vector<unsigned char>, FONT_CHARACTER_COUNT> glyph_pixels;
+	std::array<ivec2, FONT_CHARACTER_COUNT> glyph_positions;
+	int row_x = 0;
+	int row_y = 0;
+	int row_height = 0;
+	for (unsigned char c = 0; c < FONT_CHARACTER_COUNT; c++)
 	{
+		m_ftCharacters[c] = { vec4(0), ivec2(0), ivec2(0), 0, (char)c };
+		glyph_positions[c] = ivec2(0);
+
 		// load character glyph 
 		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
 		{
@@ -469,56 +721,74 @@ bool RenderSystem::initFont(GLFWwindow* window, const std::string& font_filename
 			continue;
 		}
 
-		// generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-
-		// std::cout << "texture: " << c << " = " << texture << std::endl;
-
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			face->glyph->bitmap.width,
-			face->glyph->bitmap.rows,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			face->glyph->bitmap.buffer
-		);
-
-		// set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		const FT_Bitmap& bitmap = face->glyph->bitmap;
+		const int width = bitmap.width;
+		const int rows = bitmap.rows;
+		assert(width + GLYPH_PADDING <= FONT_ATLAS_WIDTH);
+		if (row_x + width + GLYPH_PADDING > FONT_ATLAS_WIDTH) {
+			row_x = 0;
+			row_y += row_height + GLYPH_PADDING;
+			row_height = 0;
+		}
+		glyph_positions[c] = ivec2(row_x, row_y);
+		row_x += width + GLYPH_PADDING;
+		row_height = max(row_height, rows);
+
+		// the glyph slot is reused by the next load, keep a tightly packed copy of its pixels
+		std::vector<unsigned char>& pixels = glyph_pixels[c];
+		pixels.resize(width * rows);
+		for (int y = 0; y < rows; y++) {
+			memcpy(pixels.data() + y * width, bitmap.buffer + y * bitmap.pitch, width);
+		}
 
-		// now store character for later use
-		Character character = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+		// now store character for later use, uv rect is set once the atlas size is known
+		m_ftCharacters[c] = {
+			vec4(0),
+			glm::ivec2(width, rows),
 			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
 			static_cast<unsigned int>(face->glyph->advance.x),
-			c
+			(char)c
 		};
-		m_ftCharacters.insert(std::pair<char, Character>(c, character));
 	}
-	glBindTexture(GL_TEXTURE_2D, 0);
 
 	// clean up
 	FT_Done_Face(face);
 	FT_Done_FreeType(ft);
 
-	// bind buffers
+	// power of two height that fits every row
+	int atlas_height = 1;
+	while (atlas_height < row_y + row_height) atlas_height *= 2;
+
+	std::vector<unsigned char> atlas_pixels(FONT_ATLAS_WIDTH * atlas_height, 0);
+	for (int c = 0; c < FONT_CHARACTER_COUNT; c++) {
+		Character& ch = m_ftCharacters[c];
+		const ivec2& pos = glyph_positions[c];
+		for (int y = 0; y < ch.Size.y; y++) {
+			memcpy(atlas_pixels.data() + (pos.y + y) * FONT_ATLAS_WIDTH + pos.x, glyph_pixels[c].data() + y * ch.Size.x, ch.Size.x);
+		}
+		ch.UVRect = vec4((float)pos.x / FONT_ATLAS_WIDTH, (float)pos.y / atlas_height,
+			(float)ch.Size.x / FONT_ATLAS_WIDTH, (float)ch.Size.y / atlas_height);
+	}
+
+	// generate texture
+	glGenTextures(1, &m_font_atlas);
+	glBindTexture(GL_TEXTURE_2D, m_font_atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, FONT_ATLAS_WIDTH, atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas_pixels.data());
+
+	// set texture options
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	gl_has_errors();
+
+	// attributes are pointed at the instance buffer when text is drawn
 	glBindVertexArray(m_font_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+	glEnableVertexAttribArray(1);
 
 	// release buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
 	return true;
@@ -548,7 +818,7 @@ bool gl_compile_shader(GLuint shader)
 }
 
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program)
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program, ProgramCache* program_cache)
 {
 	// Opening files
 	std::ifstream vs_is(vs_path);
@@ -564,8 +834,23 @@ bool loadEffectFromFile(
 	std::stringstream vs_ss, fs_ss;
 	vs_ss << vs_is.rdbuf();
 	fs_ss << fs_is.rdbuf();
-	std::string vs_str = vs_ss.str();
-	std::string fs_str = fs_ss.str();
+	return loadEffectFromSource(vs_ss.str(), fs_ss.str(), out_program, program_cache);
+}
+
+bool loadEffectFromSource(
+	const std::string& vs_str, const std::string& fs_str, GLuint& out_program, ProgramCache* program_cache)
+{
+	// a cached binary skips compiling and linking, the sources are still read to check it is current
+	uint64_t key = 0;
+	if (program_cache != nullptr)
+	{
+		key = hash_program_sources(vs_str, fs_str);
+		out_program = glCreateProgram();
+		if (program_cache->get(key, out_program)) return true;
+		glDeleteProgram(out_program);
+		gl_has_errors();
+	}
+
 	const char* vs_src = vs_str.c_str();
 	const char* fs_src = fs_str.c_str();
 	GLsizei vs_len = (GLsizei)vs_str.size();
@@ -595,6 +880,7 @@ bool loadEffectFromFile(
 	// Linking
 	out_program = glCreateProgram();
 	gl_has_errors();
+	if (program_cache != nullptr) program_cache->prepare(out_program);
 	glAttachShader(out_program, vertex);
 	gl_has_errors();
 	glAttachShader(out_program, fragment);
@@ -632,20 +918,21 @@ bool loadEffectFromFile(
 	glDeleteShader(fragment);
 	gl_has_errors();
 
+	if (program_cache != nullptr) program_cache->put(key, out_program);
+
 	return true;
 }
 
 void RenderSystem::initializeTileInstance() {
-	tile_instance_program = glCreateProgram();
-
 	// Load shaders
 	std::string path = shader_path("tiles_instance");
 
 	const std::string vertex_shader_name = path + ".vs.glsl";
 	const std::string fragment_shader_name = path + ".fs.glsl";
 
-	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, tile_instance_program);
+	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, tile_instance_program, &program_cache);
 	assert(is_valid && (GLuint)tile_instance_program != 0);
+	tile_instance_locations.resolve(tile_instance_program);
 
 	glUseProgram(tile_instance_program);
 	gl_has_errors();
@@ -682,34 +969,22 @@ void RenderSystem::initializeTileInstance() {
 	gl_has_errors();
 
 	// sprite location data
-	int sprite_loc = glGetAttribLocation(tile_instance_program, "in_sprite_loc");
-	assert(sprite_loc >= 0);
+	tile_sprite_location_loc = glGetAttribLocation(tile_instance_program, "in_sprite_loc");
+	assert(tile_sprite_location_loc >= 0);
 	gl_has_errors();
-	glEnableVertexAttribArray(sprite_loc);
-	glVertexAttribPointer(sprite_loc, 4, GL_FLOAT, GL_FALSE, sizeof(TileInstanceData), (void*)(0));
-	gl_has_errors();
-	glVertexAttribDivisor(sprite_loc, 1);
+	glEnableVertexAttribArray(tile_sprite_location_loc);
+	glVertexAttribDivisor(tile_sprite_location_loc, 1);
 	gl_has_errors();
 
 	// transform data
-	int loc = glGetAttribLocation(tile_instance_program, "in_transform");
-	assert(loc >= 0);
-	gl_has_errors();
-	int loc1 = loc;
-	int loc2 = loc + 1;
-	int loc3 = loc + 2;
-	glEnableVertexAttribArray(loc1);
-	glVertexAttribPointer(loc1, 3, GL_FLOAT, GL_FALSE, sizeof(TileInstanceData), (void*)(sizeof(vec4)));
-	gl_has_errors();
-	glEnableVertexAttribArray(loc2);
-	glVertexAttribPointer(loc2, 3, GL_FLOAT, GL_FALSE, sizeof(TileInstanceData), (void*)(sizeof(vec4) + sizeof(vec3)));
-	gl_has_errors();
-	glEnableVertexAttribArray(loc3);
-	glVertexAttribPointer(loc3, 3, GL_FLOAT, GL_FALSE, sizeof(TileInstanceData), (void*)(sizeof(vec4) + sizeof(vec3) * 2));
+	tile_transform_loc = glGetAttribLocation(tile_instance_program, "in_transform");
+	assert(tile_transform_loc >= 0);
 	gl_has_errors();
-	glVertexAttribDivisor(loc1, 1);
-	glVertexAttribDivisor(loc2, 1);
-	glVertexAttribDivisor(loc3, 1);
+	for (int i = 0; i < 3; i++) {
+		glEnableVertexAttribArray(tile_transform_loc + i);
+		glVertexAttribDivisor(tile_transform_loc + i, 1);
+	}
+	setTileInstanceAttributes(0);
 	gl_has_errors();
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -718,89 +993,163 @@ void RenderSystem::initializeTileInstance() {
 	gl_has_errors();
 }
 
-void RenderSystem::initializeVisibilityTileInstance() {
-	visibility_tile_instance_program = glCreateProgram();
+// Points the instance attributes at the tile instance vbo, starting offset bytes in
+// Requires tiles_instance_VAO and tiles_instance_VBO to be bound
+void RenderSystem::setTileInstanceAttributes(size_t offset) {
+	const GLsizei stride = sizeof(TileInstanceData);
+	glVertexAttribPointer(tile_sprite_location_loc, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset));
+	glVertexAttribPointer(tile_transform_loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(vec4)));
+	glVertexAttribPointer(tile_transform_loc + 1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(vec4) + sizeof(vec3)));
+	glVertexAttribPointer(tile_transform_loc + 2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(vec4) + sizeof(vec3) * 2));
+	gl_has_errors();
+}
 
+void RenderSystem::initializeFog() {
 	// Load shaders
-	std::string path = shader_path("visibilitytiles_instance");
+	std::string path = shader_path("fog");
 
 	const std::string vertex_shader_name = path + ".vs.glsl";
 	const std::string fragment_shader_name = path + ".fs.glsl";
 
-	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, visibility_tile_instance_program);
-	assert(is_valid && (GLuint)visibility_tile_instance_program != 0);
+	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, fog_program, &program_cache);
+	assert(is_valid && (GLuint)fog_program != 0);
+	fog_locations.resolve(fog_program);
 
-	glUseProgram(visibility_tile_instance_program);
+	glUseProgram(fog_program);
 	gl_has_errors();
 
-	glGenBuffers(1, &visibility_tile_instance_VBO);
-	glGenVertexArrays(1, &visibility_tile_instance_VAO);
+	glGenVertexArrays(1, &fog_VAO);
+	glBindVertexArray(fog_VAO);
 	gl_has_errors();
 
-	glBindVertexArray(visibility_tile_instance_VAO);
-	gl_has_errors();
-
-	// bind vbo for colored vertex
-	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::DEBUG_LINE];
-	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::DEBUG_LINE];
+	// bind vbo for textured vertex, the map is covered by a single sprite quad
+	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
-	// Input data location as in the vertex buffer
-	GLint in_position_loc = glGetAttribLocation(visibility_tile_instance_program, "in_position");
-	GLint in_color_loc = glGetAttribLocation(visibility_tile_instance_program, "in_color");
-	gl_has_errors();
-	assert(in_position_loc >= 0);
-	assert(in_color_loc >= 0);
+	assert(fog_locations.in_position >= 0);
+	assert(fog_locations.in_texcoord >= 0);
 
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)0);
+	glEnableVertexAttribArray(fog_locations.in_position);
+	glVertexAttribPointer(fog_locations.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
 	gl_has_errors();
 
-	glEnableVertexAttribArray(in_color_loc);
-	glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE, sizeof(ColoredVertex), (void*)sizeof(vec3));
+	glEnableVertexAttribArray(fog_locations.in_texcoord);
+	// note the stride to skip the preceeding vertex position
+	glVertexAttribPointer(fog_locations.in_texcoord, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
 	gl_has_errors();
 
-	// bind visbility tiles instance vbo for instance rendering
-	glBindBuffer(GL_ARRAY_BUFFER, visibility_tile_instance_VBO);
-	gl_has_errors();
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-	// transform data
-	int loc = glGetAttribLocation(visibility_tile_instance_program, "in_transform");
-	assert(loc >= 0);
-	gl_has_errors();
-	int loc1 = loc;
-	int loc2 = loc + 1;
-	int loc3 = loc + 2;
-	glEnableVertexAttribArray(loc1);
-	glVertexAttribPointer(loc1, 3, GL_FLOAT, GL_FALSE, sizeof(VisibilityTileInstanceData), (void*)(0));
+	// one opacity texel per grid cell, filled by set_fog_texture
+	// linear filtering fades the fog across cell borders
+	glGenTextures(1, &fog_texture);
+	glBindTexture(GL_TEXTURE_2D, fog_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
 	gl_has_errors();
-	glEnableVertexAttribArray(loc2);
-	glVertexAttribPointer(loc2, 3, GL_FLOAT, GL_FALSE, sizeof(VisibilityTileInstanceData), (void*)(sizeof(vec3)));
+}
+
+void RenderSystem::initializeSpriteInstance() {
+	// Load shaders
+	std::string path = shader_path("sprite_instance");
+
+	const std::string vertex_shader_name = path + ".vs.glsl";
+	const std::string fragment_shader_name = path + ".fs.glsl";
+
+	bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, sprite_instance_program, &program_cache);
+	assert(is_valid && (GLuint)sprite_instance_program != 0);
+	sprite_instance_locations.resolve(sprite_instance_program);
+
+	glUseProgram(sprite_instance_program);
 	gl_has_errors();
-	glEnableVertexAttribArray(loc3);
-	glVertexAttribPointer(loc3, 3, GL_FLOAT, GL_FALSE, sizeof(VisibilityTileInstanceData), (void*)(sizeof(vec3) * 2));
+
+	glGenVertexArrays(1, &sprite_instance_VAO);
 	gl_has_errors();
-	glVertexAttribDivisor(loc1, 1);
-	glVertexAttribDivisor(loc2, 1);
-	glVertexAttribDivisor(loc3, 1);
+
+	glBindVertexArray(sprite_instance_VAO);
 	gl_has_errors();
 
-	// neighbors data
-	GLint in_alpha_loc = glGetAttribLocation(visibility_tile_instance_program, "in_alpha");
+	// bind vbo for textured vertex
+	const GLuint vbo = vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+	const GLuint ibo = index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+
+	GLint in_position_loc = glGetAttribLocation(sprite_instance_program, "in_position");
+	GLint in_texcoord_loc = glGetAttribLocation(sprite_instance_program, "in_texcoord");
+	assert(in_position_loc >= 0);
+	assert(in_texcoord_loc >= 0);
+
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)0);
 	gl_has_errors();
-	assert(in_alpha_loc >= 0);
-	glEnableVertexAttribArray(in_alpha_loc);
-	glVertexAttribPointer(in_alpha_loc, 1, GL_FLOAT, GL_FALSE, sizeof(VisibilityTileInstanceData), (void*)(sizeof(vec3) * 3));
+
+	glEnableVertexAttribArray(in_texcoord_loc);
+	// note the stride to skip the preceeding vertex position
+	glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void*)sizeof(vec3));
+
+	// sprite instances are streamed through the instance ring buffer
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer.get_buffer());
 	gl_has_errors();
-	glVertexAttribDivisor(in_alpha_loc, 1);
+
+	sprite_transform_loc = glGetAttribLocation(sprite_instance_program, "in_transform");
+	sprite_color_loc = glGetAttribLocation(sprite_instance_program, "in_color");
+	sprite_end_pos_loc = glGetAttribLocation(sprite_instance_program, "in_end_pos");
+	sprite_scale_loc = glGetAttribLocation(sprite_instance_program, "in_scale");
+	sprite_uv_rect_loc = glGetAttribLocation(sprite_instance_program, "in_uv_rect");
+	sprite_animation_loc = glGetAttribLocation(sprite_instance_program, "in_animation");
+	assert(sprite_transform_loc >= 0);
+	assert(sprite_color_loc >= 0);
+	assert(sprite_end_pos_loc >= 0);
+	assert(sprite_scale_loc >= 0);
+	assert(sprite_uv_rect_loc >= 0);
+	assert(sprite_animation_loc >= 0);
 	gl_has_errors();
 
+	// transform takes three attribute slots, one per column
+	for (int i = 0; i < 3; i++) {
+		glEnableVertexAttribArray(sprite_transform_loc + i);
+		glVertexAttribDivisor(sprite_transform_loc + i, 1);
+	}
+	glEnableVertexAttribArray(sprite_color_loc);
+	glVertexAttribDivisor(sprite_color_loc, 1);
+	glEnableVertexAttribArray(sprite_end_pos_loc);
+	glVertexAttribDivisor(sprite_end_pos_loc, 1);
+	glEnableVertexAttribArray(sprite_scale_loc);
+	glVertexAttribDivisor(sprite_scale_loc, 1);
+	glEnableVertexAttribArray(sprite_uv_rect_loc);
+	glVertexAttribDivisor(sprite_uv_rect_loc, 1);
+	glEnableVertexAttribArray(sprite_animation_loc);
+	glVertexAttribDivisor(sprite_animation_loc, 1);
+	setSpriteInstanceAttributes(0);
+	gl_has_errors();
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 	gl_has_errors();
 }
 
+// Points the instance attributes at the instance ring buffer, starting offset bytes in
+// Each batch of a flush starts at its own offset, as base instance drawing needs OpenGL 4.2
+// Requires sprite_instance_VAO and the instance ring buffer to be bound
+void RenderSystem::setSpriteInstanceAttributes(size_t offset) {
+	const GLsizei stride = sizeof(SpriteInstanceData);
+	glVertexAttribPointer(sprite_transform_loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset));
+	glVertexAttribPointer(sprite_transform_loc + 1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(vec3)));
+	glVertexAttribPointer(sprite_transform_loc + 2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(vec3) * 2));
+	glVertexAttribPointer(sprite_color_loc, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(mat3)));
+	glVertexAttribPointer(sprite_end_pos_loc, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(mat3) + sizeof(vec3)));
+	glVertexAttribPointer(sprite_scale_loc, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(mat3) + sizeof(vec3) + sizeof(vec2)));
+	glVertexAttribPointer(sprite_uv_rect_loc, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(mat3) + sizeof(vec3) + sizeof(vec2) * 2));
+	glVertexAttribPointer(sprite_animation_loc, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + sizeof(mat3) + sizeof(vec3) + sizeof(vec2) * 2 + sizeof(vec4)));
+	gl_has_errors();
+}
@@ -0,0 +1,115 @@
+#include "spatial_grid.hpp"
+
+SpatialGrid enemy_grid;
+
+// Maximum cells per axis, larger areas use bigger cells
+const int MAX_GRID_DIM = 128;
+
+void SpatialGrid::clear()
+{
+	staged.clear();
+	entries.clear();
+	cell_start.clear();
+	dims = { 0, 0 };
+}
+
+void SpatialGrid::insert(Entity entity, vec2 position)
+{
+	staged.push_back({ position, (unsigned int)entity });
+}
+
+ivec2 SpatialGrid::get_cell(vec2 position) const
+{
+	ivec2 cell = ivec2(floor((position - origin) / cell_size));
+	return clamp(cell, ivec2(0), dims - 1);
+}
+
+void SpatialGrid::build(float cell_size)
+{
+	entries.clear();
+	cell_start.clear();
+	dims = { 0, 0 };
+	if (staged.size() == 0) return;
+
+	vec2 min_pos = staged[0].position;
+	vec2 max_pos = staged[0].position;
+	for (const Entry& entry : staged) {
+		min_pos = min(min_pos, entry.position);
+		max_pos = max(max_pos, entry.position);
+	}
+	vec2 extent = max_pos - min_pos;
+	this->cell_size = max(cell_size, max(extent.x, extent.y) / (MAX_GRID_DIM - 1));
+	origin = min_pos;
+	dims = ivec2(extent / this->cell_size) + 1;
+
+	// Counting sort of staged entries into cells
+	cell_start.assign(dims.x * dims.y + 1, 0);
+	for (const Entry& entry : staged) {
+		ivec2 cell = get_cell(entry.position);
+		cell_start[cell.y * dims.x + cell.x + 1]++;
+	}
+	for (size_t i = 1; i < cell_start.size(); i++) {
+		cell_start[i] += cell_start[i - 1];
+	}
+	entries.resize(staged.size());
+	std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+	for (const Entry& entry : staged) {
+		ivec2 cell = get_cell(entry.position);
+		entries[fill[cell.y * dims.x + cell.x]++] = entry;
+	}
+	staged.clear();
+}
+
+int SpatialGrid::nearest(vec2 position, float max_distance) const
+{
+	if (entries.size() == 0) return -1;
+
+	ivec2 center = get_cell(position);
+	int closest_entity_id = -1;
+	float closest_distance = max_distance * max_distance;
+	int max_ring = max(dims.x, dims.y);
+
+	// Search rings of cells around the query cell, outwards
+	for (int ring = 0; ring <= max_ring; ring++) {
+		// every cell in this ring is at least (ring - 1) cells away from position
+		float ring_distance = max(ring - 1, 0) * cell_size;
+		if (ring_distance * ring_distance >= closest_distance) break;
+
+		for (int y = center.y - ring; y <= center.y + ring; y++) {
+			if (y < 0 || y >= dims.y) continue;
+			bool is_edge_row = y == center.y - ring || y == center.y + ring;
+			// inner rows only have the two cells on the ring's left and right edge
+			int step = is_edge_row ? 1 : max(2 * ring, 1);
+			for (int x = center.x - ring; x <= center.x + ring; x += step) {
+				if (x < 0 || x >= dims.x) continue;
+				int cell = y * dims.x + x;
+				for (int i = cell_start[cell]; i < cell_start[cell + 1]; i++) {
+					vec2 dp = entries[i].position - position;
+					float dot_dp = dot(dp, dp);
+					if (dot_dp < closest_distance) {
+						closest_distance = dot_dp;
+						closest_entity_id = entries[i].entity;
+					}
+				}
+			}
+		}
+	}
+	return closest_entity_id;
+}
+
+void SpatialGrid::query(vec2 min_position, vec2 max_position, std::vector<unsigned int>& entities) const
+{
+	if (entries.size() == 0) return;
+
+	// positions outside the grid were clamped into its border cells, so are boxes
+	ivec2 min_cell = get_cell(min_position);
+	ivec2 max_cell = get_cell(max_position);
+	for (int y = min_cell.y; y <= max_cell.y; y++) {
+		// cells of a row are stored next to each other
+		int first = cell_start[y * dims.x + min_cell.x];
+		int last = cell_start[y * dims.x + max_cell.x + 1];
+		for (int i = first; i < last; i++) {
+			entities.push_back(entries[i].entity);
+		}
+	}
+}
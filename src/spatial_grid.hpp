@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.hpp"
+
+// Uniform grid over world positions for nearest neighbour queries
+// Entities are staged with insert and laid out per cell by build, e.g.
+//   enemy_grid.clear();
+//   for (...) enemy_grid.insert(entity, position);
+//   enemy_grid.build(cell_size);
+//   int closest = enemy_grid.nearest(position, max_distance);
+class SpatialGrid {
+	struct Entry {
+		vec2 position;
+		unsigned int entity;
+	};
+
+	float cell_size = 1.f;
+	// world position of the top left corner of cell (0, 0)
+	vec2 origin = { 0, 0 };
+	ivec2 dims = { 0, 0 };
+	// entries of cell c are entries[cell_start[c]] .. entries[cell_start[c + 1] - 1]
+	std::vector<int> cell_start;
+	std::vector<Entry> entries;
+	// inserted entities, sorted into entries by build
+	std::vector<Entry> staged;
+
+	ivec2 get_cell(vec2 position) const;
+public:
+	// Remove all entities, keeps allocated memory for the next build
+	void clear();
+	void insert(Entity entity, vec2 position);
+	// Sort the inserted entities into cells of cell_size world units
+	void build(float cell_size);
+	// Returns the entity id closest to position within max_distance, -1 if there is none
+	int nearest(vec2 position, float max_distance) const;
+	// Appends the ids of entities in cells overlapping the box from min_position to max_position
+	// Cells are coarse, callers still have to test the positions
+	void query(vec2 min_position, vec2 max_position, std::vector<unsigned int>& entities) const;
+	size_t size() const { return entries.size(); }
+};
+
+// Lock on range of aimbot cursor and homing bullets, in tiles
+const float LOCK_ON_RANGE_TILES = 20.f;
+
+// Enemies that can be locked on to, rebuilt once per frame in WorldSystem::step
+// Used by the aimbot cursor and ENEMY_DIRECTION bullets
+extern SpatialGrid enemy_grid;
@@ -0,0 +1,114 @@
+#include "texture_cache.hpp"
+#include "disk_cache.hpp"
+
+#include "../ext/stb_image/stb_image.h"
+
+// Cache file layout after the disk cache header:
+//   uint32 entry_count
+//   per entry: uint32 path_length, char path[path_length], uint64 source_hash, int32 width, int32 height,
+//              unsigned char pixels[width * height * 4]
+static const char TEXTURE_CACHE_MAGIC[4] = { 'T', 'D', 'T', 'C' };
+// bump when the layout or the decoded pixel format changes
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+void TextureCache::load(const std::string& cache_path)
+{
+	clear();
+	this->cache_path = cache_path;
+	if (!read_file(cache_path, file_data)) return;
+
+	CacheReader reader(file_data);
+	uint32_t entry_count;
+	if (!reader.read_header(TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION) || !reader.read(&entry_count, sizeof(entry_count))) {
+		clear();
+		return;
+	}
+
+	for (uint32_t i = 0; i < entry_count; i++) {
+		std::string path;
+		Entry entry;
+		int32_t width, height;
+		if (!reader.read_string(path) || !reader.read(&entry.source_hash, sizeof(entry.source_hash)) ||
+			!reader.read(&width, sizeof(width)) || !reader.read(&height, sizeof(height)) || width <= 0 || height <= 0 ||
+			reader.remaining() / 4 / width < (size_t)height) {
+			clear();
+			return;
+		}
+		entry.dimensions = { width, height };
+		entry.pixels = reader.skip((size_t)width * height * 4);
+		entries[path] = std::move(entry);
+	}
+}
+
+const unsigned char* TextureCache::get(const std::string& path, ivec2& dimensions)
+{
+	// the source file is read anyway to check the hash, decoding reuses its bytes
+	std::vector<unsigned char> source;
+	if (!read_file(path, source)) return nullptr;
+	uint64_t source_hash = hash_bytes(source);
+
+	{
+		std::lock_guard<std::mutex> lock(entries_mutex);
+		Entry& entry = entries[path];
+		entry.is_used = true;
+		if (entry.pixels != nullptr && entry.source_hash == source_hash) {
+			hits++;
+			dimensions = entry.dimensions;
+			return entry.pixels;
+		}
+	}
+
+	// decoded without holding the lock, entries of other paths are not touched
+	ivec2 decoded_dimensions;
+	stbi_uc* data = stbi_load_from_memory(source.data(), (int)source.size(), &decoded_dimensions.x, &decoded_dimensions.y, NULL, 4);
+	if (data == NULL) return nullptr;
+	std::vector<unsigned char> decoded(data, data + (size_t)decoded_dimensions.x * decoded_dimensions.y * 4);
+	stbi_image_free(data);
+
+	std::lock_guard<std::mutex> lock(entries_mutex);
+	Entry& entry = entries[path];
+	misses++;
+	entry.source_hash = source_hash;
+	entry.dimensions = decoded_dimensions;
+	entry.decoded = std::move(decoded);
+	entry.pixels = entry.decoded.data();
+	is_dirty = true;
+
+	dimensions = entry.dimensions;
+	return entry.pixels;
+}
+
+void TextureCache::save()
+{
+	if (!is_dirty || cache_path.empty()) return;
+
+	bool is_written = write_cache_file(cache_path, TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION, [this](std::ostream& file) {
+		uint32_t entry_count = 0;
+		for (auto& pair : entries) {
+			if (pair.second.is_used && pair.second.pixels != nullptr) entry_count++;
+		}
+		file.write((const char*)&entry_count, sizeof(entry_count));
+		for (auto& pair : entries) {
+			const Entry& entry = pair.second;
+			if (!entry.is_used || entry.pixels == nullptr) continue;
+			int32_t width = entry.dimensions.x;
+			int32_t height = entry.dimensions.y;
+			write_string(file, pair.first);
+			file.write((const char*)&entry.source_hash, sizeof(entry.source_hash));
+			file.write((const char*)&width, sizeof(width));
+			file.write((const char*)&height, sizeof(height));
+			file.write((const char*)entry.pixels, (size_t)width * height * 4);
+		}
+	}, "texture cache");
+	if (is_written) is_dirty = false;
+}
+
+void TextureCache::clear()
+{
+	entries.clear();
+	file_data.clear();
+	file_data.shrink_to_fit();
+	is_dirty = false;
+	hits = 0;
+	misses = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common.hpp"
+
+// On-disk cache of decoded RGBA8 textures, so later launches skip PNG decoding, e.g.
+//   texture_cache.load(texture_cache_path());
+//   const unsigned char* pixels = texture_cache.get(path, dimensions);
+//   texture_cache.save();
+// Entries are keyed by texture path and are stale once the hash of the source file changes.
+// Pixels are uncompressed and without mip levels: every texture is sampled with GL_NEAREST.
+class TextureCache {
+	struct Entry {
+		uint64_t source_hash = 0;
+		ivec2 dimensions = { 0, 0 };
+		// points into file_data for cached entries, into decoded for decoded ones
+		const unsigned char* pixels = nullptr;
+		std::vector<unsigned char> decoded;
+		// requested since load, only those are written by save
+		bool is_used = false;
+	};
+
+	std::string cache_path;
+	// whole cache file, cached pixels are uploaded straight from it
+	std::vector<unsigned char> file_data;
+	std::unordered_map<std::string, Entry> entries;
+	bool is_dirty = false;
+	// get is called from AssetLoader workers
+	std::mutex entries_mutex;
+public:
+	// Number of textures served from the cache and decoded from their source file since load
+	int hits = 0;
+	int misses = 0;
+
+	// Reads the cache file, a missing, outdated or malformed file leaves the cache empty
+	void load(const std::string& cache_path);
+	// Returns RGBA8 pixels of the texture at path, nullptr if it can not be loaded
+	// Stale or missing entries are decoded and replace the entry
+	// Thread safe, textures are decoded in parallel
+	// Pixels are owned by the cache and stay valid until clear
+	const unsigned char* get(const std::string& path, ivec2& dimensions);
+	// Writes the used entries back to the cache file if any were decoded
+	void save();
+	// Frees all pixels
+	void clear();
+};
+
+inline std::string texture_cache_path() { return data_path() + "/texture_cache.bin"; }
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <set>
 #include <functional>
 #include <typeindex>
@@ -21,6 +22,9 @@ public:
 	}
 	operator unsigned int() { return id; } // this enables automatic casting to int
 
+	// Id of the next created entity, every lower id has been handed out
+	static unsigned int next_id() { return id_count; }
+
 	// https://stackoverflow.com/a/45896024
 	// Explicit cast, only use if necessary.
 	// Does not increase id count, as this entity is a reference
@@ -35,6 +39,7 @@ struct ContainerInterface
 	virtual void clear() = 0;
 	virtual size_t size() = 0;
 	virtual void remove(Entity e) = 0;
+	virtual void remove_all(const std::unordered_set<unsigned int>& entity_ids) = 0;
 	virtual bool has(Entity entity) = 0;
 };
 
@@ -83,7 +88,8 @@ public:
 	// A wrapper to return the component of an entity
 	Component& get(Entity e) {
 		assert(has(e) && "Entity not contained in ECS registry");
-		return components[map_entity_componentID[e]];
+		// find never inserts, unlike operator[], so draw list workers can get components concurrently
+		return components[map_entity_componentID.find(e)->second];
 	}
 
 	// Check if entity has a component of type 'Component'
@@ -113,6 +119,42 @@ public:
 		}
 	};
 
+	// Remove the components of every entity in entity_ids
+	// A large batch is removed in a single packing pass instead of one swap and hash erase per entity
+	void remove_all(const std::unordered_set<unsigned int>& entity_ids)
+	{
+		if (components.size() == 0 || entity_ids.size() == 0) return;
+
+		// Few entities compared to the container, removing them one by one is cheaper than a full pass
+		if (entity_ids.size() * 4 < components.size())
+		{
+			for (unsigned int id : entity_ids)
+				remove(Entity((int)id));
+			return;
+		}
+
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < entities.size(); i++)
+		{
+			unsigned int id = entities[i];
+			if (entity_ids.count(id) > 0)
+			{
+				map_entity_componentID.erase(id);
+				continue;
+			}
+			if (kept != i)
+			{
+				components[kept] = std::move(components[i]);
+				entities[kept] = entities[i];
+				map_entity_componentID[id] = kept;
+			}
+			kept++;
+		}
+		// Note, erase instead of resize since Entity() would allocate new ids
+		components.erase(components.begin() + kept, components.end());
+		entities.erase(entities.begin() + kept, entities.end());
+	}
+
 	// Remove all components of type 'Component'
 	void clear()
 	{
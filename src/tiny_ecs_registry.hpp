@@ -51,6 +51,7 @@ public:
 	ComponentContainer<BulletPattern> bulletPatterns;
 	ComponentContainer<BulletDelayTimer> bulletDelayTimers;
 	ComponentContainer<BulletDeathTimer> bulletDeathTimers;
+	ComponentContainer<BulletDissolve> bulletDissolves;
 	ComponentContainer<BulletLoop> bulletLoops;
 	ComponentContainer<PlayerHeart> playerHearts;
 	ComponentContainer<BossHealthBarUI> bossHealthBarUIs;
@@ -71,7 +72,6 @@ public:
 	ComponentContainer<DummyEnemySpawner> dummyenemyspawners;
 	ComponentContainer<DummyEnemyLink> dummyEnemyLink;
 	ComponentContainer<TileInstanceData> tileInstanceData;
-	ComponentContainer<VisibilityTileInstanceData> visibilityTileInstanceData;
 	ComponentContainer<Button> buttons;
 	ComponentContainer<MainMenu> mainMenus;
 	ComponentContainer<PauseMenu> pauseMenus;
@@ -149,6 +149,7 @@ public:
 		registry_list.push_back(&bulletPatterns);
 		registry_list.push_back(&bulletDelayTimers);
 		registry_list.push_back(&bulletDeathTimers);
+		registry_list.push_back(&bulletDissolves);
 		registry_list.push_back(&bulletLoops);
 		registry_list.push_back(&playerHearts);
 		registry_list.push_back(&bossHealthBarUIs);
@@ -169,7 +170,6 @@ public:
 		registry_list.push_back(&dummyenemyspawners);
 		registry_list.push_back(&dummyEnemyLink);
 		registry_list.push_back(&tileInstanceData);
-		registry_list.push_back(&visibilityTileInstanceData);
 		registry_list.push_back(&buttons);
 		registry_list.push_back(&mainMenus);
 		registry_list.push_back(&pauseMenus);
@@ -227,6 +227,17 @@ public:
 		for (ContainerInterface* reg : registry_list)
 			reg->remove(e);
 	}
+
+	// Remove every entity that has a component in container, e.g. remove_all_entities_with(registry.enemyBullets)
+	// Each container is packed once, instead of one remove per container per entity
+	template <typename Component>
+	void remove_all_entities_with(ComponentContainer<Component>& container) {
+		if (container.size() == 0) return;
+		// copy the ids, container itself is cleared in the loop below
+		std::unordered_set<unsigned int> entity_ids(container.entities.begin(), container.entities.end());
+		for (ContainerInterface* reg : registry_list)
+			reg->remove_all(entity_ids);
+	}
 };
 
 extern ECSRegistry registry;
\ No newline at end of file
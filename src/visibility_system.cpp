@@ -5,8 +5,9 @@ void VisibilitySystem::restart_map()
 	// restart visibility map
 	map = std::vector<std::vector<int>>(WORLD_HEIGHT_DEFAULT, std::vector<int>(WORLD_WIDTH_DEFAULT, (int)VISIBILITY_STATE::VISIBLE));
 
-	// restart reference map
-	reference_map = std::vector<std::vector<int>>(WORLD_HEIGHT_DEFAULT, std::vector<int>(WORLD_WIDTH_DEFAULT, -1));
+	// restart fog map
+	fog_map.assign(WORLD_WIDTH_DEFAULT * WORLD_HEIGHT_DEFAULT, FOG_CLEAR);
+	is_fog_dirty = false;
 
 	close_list.clear();
 	next_pos.clear();
@@ -56,7 +57,7 @@ void VisibilitySystem::step(float elapsed_ms)
 
 				// check if it's the first tile that is not visible, otherwise expand on previous
 				if (map[grid_pos.y][grid_pos.x] == (int)VISIBILITY_STATE::NOT_VISIBLE && next_pos.empty()) {
-					registry.visibilityTileInstanceData.get((Entity)reference_map[grid_pos.y][grid_pos.x]).alpha = 0.5;
+					set_tile_half_visible(grid_pos);
 					next_pos.push_back(grid_pos);
 					curr_num = 1;
 				}
@@ -75,8 +76,8 @@ void VisibilitySystem::step(float elapsed_ms)
 								candidate.x >= room.top_left.x - 1 && candidate.x <= room.bottom_right.x + 1 &&
 								candidate.y >= room.top_left.y - 1 && candidate.y <= room.bottom_right.y + 1 &&
 								map[candidate.y][candidate.x] == (int)VISIBILITY_STATE::NOT_VISIBLE &&
-								reference_map[candidate.y][candidate.x] != -1) {
-								registry.visibilityTileInstanceData.get((Entity)reference_map[candidate.y][candidate.x]).alpha = 0.5;
+								fog_at(candidate) != FOG_CLEAR) {
+								set_tile_half_visible(candidate);
 								close_list.insert(candidate);
 								next_pos.push_back(candidate);
 								next_num++;
@@ -87,8 +88,8 @@ void VisibilitySystem::step(float elapsed_ms)
 										if (door_candidate.x >= 0 && door_candidate.x < WORLD_WIDTH_DEFAULT &&
 											door_candidate.y >= 0 && door_candidate.y < WORLD_HEIGHT_DEFAULT &&
 											map[door_candidate.y][door_candidate.x] == (int)VISIBILITY_STATE::NOT_VISIBLE &&
-											reference_map[door_candidate.y][door_candidate.x] != -1) {
-											registry.visibilityTileInstanceData.get((Entity)reference_map[door_candidate.y][door_candidate.x]).alpha = 0.5;
+											fog_at(door_candidate) != FOG_CLEAR) {
+											set_tile_half_visible(door_candidate);
 										}
 									}
 								}
@@ -97,13 +98,13 @@ void VisibilitySystem::step(float elapsed_ms)
 						curr_num--;
 					}
 					curr_num = next_num;
-					renderer->set_visibility_tiles_instance_buffer();
+					upload_fog();
 				}
 			}
 			else {
 				// in a corridor
 				if (map[grid_pos.y][grid_pos.x] == (int)VISIBILITY_STATE::NOT_VISIBLE && next_pos.empty()) {
-					registry.visibilityTileInstanceData.get((Entity)reference_map[grid_pos.y][grid_pos.x]).alpha = 0.5;
+					set_tile_half_visible(grid_pos);
 					is_door_found = false;
 					next_pos.push_back(grid_pos);
 					curr_num = 1;
@@ -122,8 +123,8 @@ void VisibilitySystem::step(float elapsed_ms)
 									candidate.x >= 0 && candidate.x < WORLD_WIDTH_DEFAULT &&
 									candidate.y >= 0 && candidate.y < WORLD_HEIGHT_DEFAULT &&
 									map[candidate.y][candidate.x] == (int)VISIBILITY_STATE::NOT_VISIBLE &&
-									reference_map[candidate.y][candidate.x] != -1) {
-									registry.visibilityTileInstanceData.get((Entity)reference_map[candidate.y][candidate.x]).alpha = 0.5;
+									fog_at(candidate) != FOG_CLEAR) {
+									set_tile_half_visible(candidate);
 									close_list.insert(candidate);
 									next_pos.push_back(candidate);
 									next_num++;
@@ -135,8 +136,8 @@ void VisibilitySystem::step(float elapsed_ms)
 											if (door_candidate.x >= 0 && door_candidate.x < WORLD_WIDTH_DEFAULT &&
 												door_candidate.y >= 0 && door_candidate.y < WORLD_HEIGHT_DEFAULT &&
 												map[door_candidate.y][door_candidate.x] == (int)VISIBILITY_STATE::NOT_VISIBLE &&
-												reference_map[door_candidate.y][door_candidate.x] != -1) {
-												registry.visibilityTileInstanceData.get((Entity)reference_map[door_candidate.y][door_candidate.x]).alpha = 0.5;
+												fog_at(door_candidate) != FOG_CLEAR) {
+												set_tile_half_visible(door_candidate);
 											}
 										}
 									}
@@ -146,7 +147,7 @@ void VisibilitySystem::step(float elapsed_ms)
 						curr_num--;
 					}
 					curr_num = next_num;
-					renderer->set_visibility_tiles_instance_buffer();
+					upload_fog();
 				}
 			}
 		}
@@ -157,14 +158,35 @@ void VisibilitySystem::step(float elapsed_ms)
 }
 
 void VisibilitySystem::set_tile_visible(coord grid_pos) {
-	if (reference_map[grid_pos.y][grid_pos.x] != -1 && map[grid_pos.y][grid_pos.x] == (int)VISIBILITY_STATE::NOT_VISIBLE) {
-		Entity entity = (Entity)reference_map[grid_pos.y][grid_pos.x];
+	if (fog_at(grid_pos) != FOG_CLEAR && map[grid_pos.y][grid_pos.x] == (int)VISIBILITY_STATE::NOT_VISIBLE) {
 		map[grid_pos.y][grid_pos.x] = (int)VISIBILITY_STATE::VISIBLE;
-		registry.remove_all_components_of(entity);
-		reference_map[grid_pos.y][grid_pos.x] = -1;
+		fog_at(grid_pos) = FOG_CLEAR;
+		mark_fog_dirty(grid_pos);
 	}
 }
 
+void VisibilitySystem::set_tile_half_visible(coord grid_pos) {
+	fog_at(grid_pos) = FOG_HALF;
+	mark_fog_dirty(grid_pos);
+}
+
+void VisibilitySystem::mark_fog_dirty(coord grid_pos) {
+	if (!is_fog_dirty) {
+		fog_dirty_min = grid_pos;
+		fog_dirty_max = grid_pos;
+		is_fog_dirty = true;
+		return;
+	}
+	fog_dirty_min = min(fog_dirty_min, ivec2(grid_pos));
+	fog_dirty_max = max(fog_dirty_max, ivec2(grid_pos));
+}
+
+void VisibilitySystem::upload_fog() {
+	if (!is_fog_dirty) return;
+	renderer->update_fog_texture(fog_map.data(), fog_dirty_min, fog_dirty_max);
+	is_fog_dirty = false;
+}
+
 void VisibilitySystem::print_visibility_map()
 {
 	printf(">>>>>>>>>>>>>>> VISIBILITY MAP <<<<<<<<<<<<<<<<\n");
@@ -177,12 +199,12 @@ void VisibilitySystem::print_visibility_map()
 	printf("\n");
 }
 
-void VisibilitySystem::print_reference_map()
+void VisibilitySystem::print_fog_map()
 {
-	printf(">>>>>>>>>>>>>>> REFERENCE MAP <<<<<<<<<<<<<<<<\n");
-	for (int i = 0; i < reference_map.size(); ++i) {
-		for (int j = 0; j < reference_map[i].size(); ++j) {
-			printf("%d ", reference_map[i][j]);
+	printf(">>>>>>>>>>>>>>> FOG MAP <<<<<<<<<<<<<<<<\n");
+	for (int i = 0; i < WORLD_HEIGHT_DEFAULT; ++i) {
+		for (int j = 0; j < WORLD_WIDTH_DEFAULT; ++j) {
+			printf("%d ", fog_map[i * WORLD_WIDTH_DEFAULT + j]);
 		}
 		printf("\n");
 	}
@@ -15,25 +15,32 @@ enum class VISIBILITY_STATE {
 	NOT_VISIBLE // 1
 };
 
+// fog opacities stored in VisibilitySystem::fog_map
+const unsigned char FOG_CLEAR = 0;
+const unsigned char FOG_HALF = 128;
+const unsigned char FOG_OPAQUE = 255;
+
 class VisibilitySystem {
 public:
 	// copy of the world_map size
 	// 0 - visible, no quad rendered on top
 	// 1 - not visible, black quad rendered on top
 	std::vector<std::vector<int>> map;
-	// copy of the world_map size
-	// mapping between map and entity id, allows for deletion
+	// copy of the world_map size, row major (index y * WORLD_WIDTH_DEFAULT + x)
+	// fog opacity over each cell, uploaded as is to the renderer's fog texture
 	// each cell is either:
-	// -1 - no entity
-	// number != -1 - entity id
-	std::vector<std::vector<int>> reference_map;
+	// FOG_CLEAR - no fog, cell has no tile or was revealed
+	// FOG_HALF - cell is being revealed
+	// FOG_OPAQUE - cell is hidden
+	std::vector<unsigned char> fog_map;
+	unsigned char& fog_at(coord grid_pos) { return fog_map[(int)grid_pos.y * WORLD_WIDTH_DEFAULT + (int)grid_pos.x]; }
 
-	// restart visibility and reference maps to default 0 and -1 respectively
+	// restart visibility and fog maps to default 0 and FOG_CLEAR respectively
 	// IMPORTANT ORDER OF OPERATIONS:
-	// (1) Call VisibilitySystem::restart_map -> map to 0, reference_map to -1
-	// (2) Call MapSystem::generate_all_tiles -> createTile -> populates reference_map with entities
+	// (1) Call VisibilitySystem::restart_map -> map to 0, fog_map to FOG_CLEAR
+	// (2) Call MapSystem::generate_all_tiles -> createTile -> sets fog_map to FOG_OPAQUE under tiles
 	// (3) Call VisibilitySystem::init_visibility -> populates map with 1 for floors/walls
-	// (4) Call RenderSystem::set_visibility_tiles_instance_buffer_max (takes info from (2))
+	// (4) Call RenderSystem::set_fog_texture (takes info from (2))
 	// Note: 
 	// - Calling VisibilitySystem::restart_map not at (1) will result in error
 	// - (3) and (4) are interchangeable
@@ -45,7 +52,7 @@ public:
 
 	// Utilities
 	void print_visibility_map();
-	void print_reference_map();
+	void print_fog_map();
 private:
 	// BFS floodfill
 	// keeps track of next grid positions to reveal and number of tiles
@@ -81,8 +88,18 @@ private:
 	float counter_ms = 0;
 	float counter_ms_default = 60;
 
-	// set tile to be visible by removing visibility tile
+	// set tile to be visible by clearing its fog
 	void set_tile_visible(coord grid_pos);
+	// dim the fog over the tile, tile must still be covered by fog
+	void set_tile_half_visible(coord grid_pos);
+
+	// cells of fog_map changed since the last upload to the fog texture
+	bool is_fog_dirty = false;
+	ivec2 fog_dirty_min;
+	ivec2 fog_dirty_max;
+	void mark_fog_dirty(coord grid_pos);
+	// uploads the changed rectangle of fog_map
+	void upload_fog();
 
 	// Game state
 	RenderSystem* renderer;
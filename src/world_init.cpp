@@ -46,6 +46,7 @@ Entity createBullet(RenderSystem* renderer, float entity_speed, vec2 entity_posi
 			ani.spritesheet_scale = { 1.f / 6.f, 1.f };
 			ani.render_pos = { 1.f / 6.f, 1.f };
 			ani.is_active = true;
+			ani.start_ms = uni_timer.animation_ms;
 			// aimbot bullet will stop playing after a while
 			registry.alwaysplayAni.insert(entity, ani);
 
@@ -66,6 +67,7 @@ Entity createBullet(RenderSystem* renderer, float entity_speed, vec2 entity_posi
 				ani.spritesheet_scale = { 1.f / 6.f, 1.f };
 				ani.render_pos = { 1.f / 6.f, 1.f };
 				ani.is_active = true;
+				ani.start_ms = uni_timer.animation_ms;
 				// aimbot bullet will stop playing after a while
 				registry.alwaysplayAni.insert(entity, ani);
 
@@ -110,7 +112,8 @@ Entity createBullet(RenderSystem* renderer, float entity_speed, vec2 entity_posi
 			entity,
 			{ texture_asset,
 			 EFFECT_ASSET_ID::TEXTURED,
-			 GEOMETRY_BUFFER_ID::SPRITE });
+			 GEOMETRY_BUFFER_ID::SPRITE,
+			 RENDER_LAYER::PLAYER_BULLET });
 	}
 	else {
 		// enemy bullets do not have render requests since they are instance rendered
@@ -124,51 +127,38 @@ Entity createBullet(RenderSystem* renderer, float entity_speed, vec2 entity_posi
 	return entity;
 }
 
-Entity createBulletDisappear(RenderSystem* renderer, vec2 entity_position, float rotation_angle, bool is_player_bullet)
+void createBulletDisappear(vec2 entity_position, float rotation_angle)
 {
-	auto entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.meshPtrs.emplace(entity, &mesh);
+	particles.spawn(VFX_TYPE::BULLET_DISAPPEAR, entity_position, vec2({ BULLET_BB_WIDTH, BULLET_BB_HEIGHT }), rotation_angle);
+}
 
-	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
-	motion.angle = rotation_angle;
-	motion.position = entity_position; // bullet spawns from entity's center position
-	// Setting initial values, scale is negative to make it face the opposite way
-	motion.scale = vec2({ BULLET_BB_WIDTH, BULLET_BB_HEIGHT });
+Entity createBulletDissolve(const std::vector<Entity>& bullets)
+{
+	auto entity = Entity();
 
-	auto& kinematic = registry.kinematics.emplace(entity);
+	// copy the bullet transforms, the bullets themselves are removed right after
+	BulletDissolve& dissolve = registry.bulletDissolves.emplace(entity);
+	dissolve.positions.reserve(bullets.size());
+	dissolve.angles.reserve(bullets.size());
+	dissolve.scales.reserve(bullets.size());
+	for (Entity bullet : bullets) {
+		if (!registry.motions.has(bullet)) continue;
+		Motion& motion = registry.motions.get(bullet);
+		dissolve.positions.push_back(motion.position);
+		dissolve.angles.push_back(motion.angle);
+		dissolve.scales.push_back(motion.scale);
+	}
 
-	// Set the collision box
-	//auto& collidable = registry.collidables.emplace(entity);
-	//collidable.size = abs(motion.scale);
+	return entity;
+}
 
-	// Create and (empty) bullet component to be able to refer to all bullets
-	if (is_player_bullet) {
-		registry.renderRequests.insert(
-			entity,
-			{ TEXTURE_ASSET_ID::REIMU_BULLET_DISAPPEAR,
-			 EFFECT_ASSET_ID::TEXTURED,
-			 GEOMETRY_BUFFER_ID::SPRITE });
-	}
-	else {
-		registry.renderRequests.insert(
-			entity,
-			{ TEXTURE_ASSET_ID::ENEMY_BULLET,
-			 EFFECT_ASSET_ID::TEXTURED,
-			 GEOMETRY_BUFFER_ID::SPRITE });
+void removeEnemyBullets(bool dissolve)
+{
+	if (registry.enemyBullets.size() == 0) return;
+	if (dissolve) {
+		createBulletDissolve(registry.enemyBullets.entities);
 	}
-	EntityAnimation ani;
-	ani.isCursor = false;
-	ani.offset = 0;
-	ani.frame_rate_ms = 50;
-	ani.full_rate_ms = 50;
-	ani.spritesheet_scale = { 0.25, 1 };
-	ani.render_pos = { 0.25, 1 };
-	registry.alwaysplayAni.insert(entity, ani);
-	return entity;
+	registry.remove_all_entities_with(registry.enemyBullets);
 }
 
 Entity createHealth(RenderSystem* renderer, vec2 position)
@@ -182,8 +172,7 @@ Entity createHealth(RenderSystem* renderer, vec2 position)
 	registry.kinematics.emplace(entity);
 	auto& collidable = registry.collidables.emplace(entity);
 	collidable.size = abs(motion.scale);
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<> distrib(0, 1);
 	double number = distrib(gen);
 	double number_y = distrib(gen) / 2;
@@ -234,8 +223,7 @@ Entity createPurchasableHealth(RenderSystem* renderer, vec2 position)
 	registry.kinematics.emplace(entity);
 	auto& collidable = registry.collidables.emplace(entity);
 	collidable.size = abs(motion.scale);
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<> distrib(0, 1);
 	double number = distrib(gen);
 	auto& purchasable = registry.purchasableables.emplace(entity);
@@ -333,8 +321,7 @@ Entity createPurchasableAmmo(RenderSystem* renderer, vec2 position, AMMO_TYPE am
 			EFFECT_ASSET_ID::TEXTURED,
 			GEOMETRY_BUFFER_ID::SPRITE });
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<> distrib(0, 1);
 	double number = distrib(gen);
 	double number_y = distrib(gen) / 2;
@@ -360,8 +347,7 @@ Entity createTreasure(RenderSystem* renderer, vec2 position, bool is_bezier)
 	auto& collidable = registry.collidables.emplace(entity);
 	collidable.size = abs(motion.scale);
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<> distrib(0, 1);
 	double number = distrib(gen);
 	double number_y = distrib(gen) / 2;
@@ -472,7 +458,8 @@ Entity createParralex(RenderSystem* renderer, vec2 position) {
 		entity,
 		{ TEXTURE_ASSET_ID::PARRALEX,
 			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::PARALLAX });
 	return entity;
 }
 
@@ -497,7 +484,8 @@ Entity createCloud(RenderSystem* renderer, vec2 position, float parrallax_value,
 		entity,
 		{ TEXTURE_ASSET_ID::CLOUDS,
 			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::PARALLAX });
 	return entity;
 }
 
@@ -522,8 +510,7 @@ Entity createCoin(RenderSystem* renderer, vec2 position, int value, float bezier
 	kinematic.speed_modified = 1.f * kinematic.speed_base;
 	kinematic.direction = { 0, 1 };*/
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<> distrib(bezier_start, bezier_end);
 	std::uniform_real_distribution<> x_distrib(0.0, 1.0);
 
@@ -765,7 +752,8 @@ Entity createPlayer(RenderSystem* renderer, vec2 pos)
 		entity,
 		{ TEXTURE_ASSET_ID::PLAYER, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::PLAYER,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::PLAYER });
 
 	BulletSpawner bs;
 	bs.fire_rate = 3;
@@ -797,7 +785,8 @@ Entity createFocusDot(RenderSystem* renderer, vec2 pos, vec2 size)
 		entity,
 		{ TEXTURE_ASSET_ID::FOCUS_DOT, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::FOCUS_DOT });
 
 	return entity;
 }
@@ -829,7 +818,8 @@ Entity createAimbotCursor(RenderSystem* renderer, vec2 pos, float scale)
 		entity,
 		{ TEXTURE_ASSET_ID::AIMBOT_CURSOR,
 			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::AIMBOT_CURSOR });
 
 	return entity;
 }
@@ -852,7 +842,8 @@ Entity createCombo(RenderSystem* renderer)
 		entity,
 		{ TEXTURE_ASSET_ID::C, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::COMBO,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::UI });
 
 	return entity;
 }
@@ -873,7 +864,8 @@ Entity createWin(RenderSystem* renderer) {
 		entity,
 		{ TEXTURE_ASSET_ID::WINDEATH_SCREEN,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.winMenus.emplace(entity);
 	registry.winMenus.emplace(createText(vec2(0, -200), vec2(2, 2), "You WIN !!!", vec3(0, 0, 0), true, false));
 
@@ -914,7 +906,8 @@ Entity createInfographic(RenderSystem* renderer) {
 		entity,
 		{ TEXTURE_ASSET_ID::WINDEATH_SCREEN,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.infographicsMenus.emplace(entity);
 
 	//Picture
@@ -932,7 +925,8 @@ Entity createInfographic(RenderSystem* renderer) {
 		entity2,
 		{ TEXTURE_ASSET_ID::INFOGRAPHIC,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.infographicsMenus.emplace(entity2);
 
 	return entity;
@@ -953,7 +947,8 @@ Entity createOptions(RenderSystem* renderer) {
 		entity,
 		{ TEXTURE_ASSET_ID::WINDEATH_SCREEN,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.optionMenus.emplace(entity);
 
 	return entity;
@@ -975,7 +970,8 @@ Entity createLose(RenderSystem* renderer) {
 		entity,
 		{ TEXTURE_ASSET_ID::WINDEATH_SCREEN,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.loseMenus.emplace(entity);
 	auto entity_reimu = Entity();
 
@@ -991,7 +987,8 @@ Entity createLose(RenderSystem* renderer) {
 		entity_reimu,
 		{ TEXTURE_ASSET_ID::REIMUCRY,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.loseMenus.emplace(entity_reimu);
 	registry.loseMenus.emplace(createText(vec2(0, -200), vec2(1.5, 1.5), "Game Over!!!", vec3(0, 0, 0), true, false));
 
@@ -1016,7 +1013,8 @@ void createDialogue(CHARACTER character, std::string sentence, CHARACTER talk_2,
 			reimu_entity,
 			{ TEXTURE_ASSET_ID::REIMU_PORTRAIT, // TEXTURE_COUNT indicates that no txture is needed
 				EFFECT_ASSET_ID::UI,
-				GEOMETRY_BUFFER_ID::SPRITE });
+				GEOMETRY_BUFFER_ID::SPRITE,
+				RENDER_LAYER::DIALOGUE });
 	}
 	else {
 		ani_reimu.render_pos = { 1 / 6.f * (1 + (int)EMOTION::NORMAL), 1 };
@@ -1024,7 +1022,8 @@ void createDialogue(CHARACTER character, std::string sentence, CHARACTER talk_2,
 			reimu_entity,
 			{ TEXTURE_ASSET_ID::REIMU_PORTRAIT, // TEXTURE_COUNT indicates that no txture is needed
 				EFFECT_ASSET_ID::GREY,
-				GEOMETRY_BUFFER_ID::SPRITE });
+				GEOMETRY_BUFFER_ID::SPRITE,
+				RENDER_LAYER::DIALOGUE });
 	}
 
 	if (talk_2 != CHARACTER::NONE) {
@@ -1046,7 +1045,8 @@ void createDialogue(CHARACTER character, std::string sentence, CHARACTER talk_2,
 				other_entity,
 				{ static_cast<TEXTURE_ASSET_ID>((int)TEXTURE_ASSET_ID::REIMU_PORTRAIT + (int)talk_2), // TEXTURE_COUNT indicates that no txture is needed
 					EFFECT_ASSET_ID::UI,
-					GEOMETRY_BUFFER_ID::SPRITE });
+					GEOMETRY_BUFFER_ID::SPRITE,
+					RENDER_LAYER::DIALOGUE });
 		}
 		else {
 			ani_other.render_pos = { 1 / 6.f * (1 + (int)EMOTION::NORMAL), 1 };
@@ -1054,7 +1054,8 @@ void createDialogue(CHARACTER character, std::string sentence, CHARACTER talk_2,
 				other_entity,
 				{ static_cast<TEXTURE_ASSET_ID>((int)TEXTURE_ASSET_ID::REIMU_PORTRAIT + (int)talk_2), // TEXTURE_COUNT indicates that no txture is needed
 					EFFECT_ASSET_ID::GREY,
-					GEOMETRY_BUFFER_ID::SPRITE });
+					GEOMETRY_BUFFER_ID::SPRITE,
+					RENDER_LAYER::DIALOGUE });
 		}
 	}
 
@@ -1070,7 +1071,8 @@ void createDialogue(CHARACTER character, std::string sentence, CHARACTER talk_2,
 		dialogue_entity,
 		{ TEXTURE_ASSET_ID::DIALOGUE_BOX, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::DIALOGUE });
 
 	createText({ 0,window_px_half.y - 170 }, { 0.8,0.8 }, sentence, vec3(0, 0, 0), false, false);
 }
@@ -1098,101 +1100,19 @@ Entity createKey(vec2 pos, vec2 size, KEYS key, bool is_on_ui, bool is_active, f
 		entity,
 		{ TEXTURE_ASSET_ID::KEYS, // TEXTURE_COUNT indicates that no txture is needed
 			is_on_ui ? EFFECT_ASSET_ID::UI : EFFECT_ASSET_ID::TEXTURED,
-					GEOMETRY_BUFFER_ID::SPRITE });
+					GEOMETRY_BUFFER_ID::SPRITE,
+					is_on_ui ? RENDER_LAYER::UI : RENDER_LAYER::WORLD_UI });
 
 	return entity;
 }
 
-Entity createVFX(RenderSystem* renderer, vec2 pos, vec2 scale, float angle, VFX_TYPE type) {
-	auto entity = Entity();
-
-	// Setting initial motion values
-	Motion& motion = registry.motions.emplace(entity);
-	motion.position = pos;
-	motion.angle = angle;
-	motion.scale = scale;
-
-	EntityAnimation playonce_ani;
-	// Set explosion as default, could change in switch statement below
-	TEXTURE_ASSET_ID texture_asset = TEXTURE_ASSET_ID::AOE_AMMO_EXPLOSION;
-
-	switch (type) {
-	case VFX_TYPE::AOE_AMMO_EXPLOSION: {
-		texture_asset = TEXTURE_ASSET_ID::AOE_AMMO_EXPLOSION;
-		playonce_ani.spritesheet_scale = { 1.f / 82.f, 1.f };
-		playonce_ani.render_pos = { 1 / 82.f, 1.f };
-		playonce_ani.frame_rate_ms = 1000.f / 60.f;
-		playonce_ani.full_rate_ms = 1000.f / 60.f;
-		playonce_ani.is_active = true;
-		break;
-	}
-	case VFX_TYPE::AOE_AMMO_DISAPPEAR: {
-		texture_asset = TEXTURE_ASSET_ID::AOE_AMMO_BULLET_DISAPPEAR;
-		playonce_ani.spritesheet_scale = { 1.f / 4.f, 1.f };
-		playonce_ani.render_pos = { 1 / 4.f, 1.f };
-		playonce_ani.frame_rate_ms = 1000.f / 10.f;
-		playonce_ani.full_rate_ms = 1000.f / 10.f;
-		playonce_ani.is_active = true;
-		break;
-	}
-	case VFX_TYPE::AIMBOT_AMMO_DISAPPEAR: {
-		texture_asset = TEXTURE_ASSET_ID::AIMBOT_AMMO_BULLET_DISAPPEAR;
-		playonce_ani.spritesheet_scale = { 1.f / 4.f, 1.f };
-		playonce_ani.render_pos = { 1 / 4.f, 1.f };
-		playonce_ani.frame_rate_ms = 1000.f / 10.f;
-		playonce_ani.full_rate_ms = 1000.f / 10.f;
-		playonce_ani.is_active = true;
-		break;
-	}
-	case VFX_TYPE::HIT_SPARK: {
-		texture_asset = TEXTURE_ASSET_ID::HIT_SPARK;
-		playonce_ani.spritesheet_scale = { 1.f / 7.f, 1.f };
-		playonce_ani.render_pos = { 1 / 7.f, 1.f };
-		playonce_ani.frame_rate_ms = 1000.f / 10.f;
-		playonce_ani.full_rate_ms = 1000.f / 10.f;
-		playonce_ani.is_active = true;
-		break;
-	}
-	default:
-		break;
-	}
-
-	registry.playonceAni.insert(entity, playonce_ani);
-	registry.renderRequests.insert(
-		entity,
-		{ texture_asset,
-		EFFECT_ASSET_ID::TEXTURED,
-		GEOMETRY_BUFFER_ID::SPRITE });
-
-	return entity;
+void createVFX(vec2 pos, vec2 scale, float angle, VFX_TYPE type) {
+	particles.spawn(type, pos, scale, angle);
 }
 
-
-Entity createCriHit(RenderSystem* renderer, vec2 pos)
+void createCriHit(vec2 pos)
 {
-	auto entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.meshPtrs.emplace(entity, &mesh);
-
-	// Setting initial motion values
-	Motion& motion = registry.motions.emplace(entity);
-	motion.position = pos;
-	motion.angle = M_PI;
-	motion.scale = { 128 * 0.4, 128 * 0.4 };
-
-	Kinematic& kin = registry.kinematics.emplace(entity);
-	kin.velocity = { 0, -300 };
-	kin.direction = { 0,-1 };
-
-	registry.renderRequests.insert(
-		entity,
-		{ TEXTURE_ASSET_ID::CRTHITICON, // TEXTURE_COUNT indicates that no txture is needed
-			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE });
-
-	return entity;
+	particles.spawn(VFX_TYPE::CRITICAL_HIT_ICON, pos, { 128 * 0.4, 128 * 0.4 }, M_PI);
 }
 
 Entity createBossHealthBarUI(RenderSystem* renderer, Entity boss, std::string boss_name, vec3 name_color) {
@@ -1218,7 +1138,8 @@ Entity createBossHealthBarUI(RenderSystem* renderer, Entity boss, std::string bo
 		entity,
 		{ TEXTURE_ASSET_ID::BOSS_HEALTH_BAR,
 			EFFECT_ASSET_ID::BOSSHEALTHBAR,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::BOSS_HEALTH_BAR });
 
 	return entity;
 }
@@ -1240,7 +1161,8 @@ Entity createHealthUI(RenderSystem* renderer)
 		entity_head,
 		{ TEXTURE_ASSET_ID::REIMU_HEAD, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::UI });
 	registry.colors.insert(entity_head, { 1,1,1 });
 
 
@@ -1259,7 +1181,8 @@ Entity createHealthUI(RenderSystem* renderer)
 		entity_inv,
 		{ TEXTURE_ASSET_ID::FOCUS_BAR, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::PLAYER_HB,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::UI });
 	registry.colors.insert(entity_inv, { 1,1,1 });
 
 	auto entity = Entity();
@@ -1277,7 +1200,8 @@ Entity createHealthUI(RenderSystem* renderer)
 		entity,
 		{ TEXTURE_ASSET_ID::REIMU_HEALTH, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::PLAYER_HB,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::UI });
 	registry.colors.insert(entity, { 1,1,1 });
 	return entity;
 }
@@ -1297,7 +1221,8 @@ std::vector<Entity> createAttributeUI(RenderSystem* renderer)
 		entity_coin,
 		{ TEXTURE_ASSET_ID::COIN_STATIC, // TEXTURE_COUNT indicates that no txture is needed
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::UI });
 	registry.colors.insert(entity_coin, { 1,1,1 });
 	entity_array.push_back(entity_coin);
 
@@ -1318,7 +1243,8 @@ std::vector<Entity> createAttributeUI(RenderSystem* renderer)
 			entity,
 			{ static_cast<TEXTURE_ASSET_ID>((int)TEXTURE_ASSET_ID::ATTACKDMG + i), // TEXTURE_COUNT indicates that no txture is needed
 				EFFECT_ASSET_ID::UI,
-				GEOMETRY_BUFFER_ID::SPRITE });
+				GEOMETRY_BUFFER_ID::SPRITE,
+				RENDER_LAYER::UI });
 		registry.colors.insert(entity, { 1,1,1 });
 		entity_array.push_back(entity);
 	}
@@ -1406,7 +1332,8 @@ Entity createRoomSignifier(RenderSystem* renderer, vec2 position, ROOM_TYPE room
 		entity,
 		{ static_cast<TEXTURE_ASSET_ID>((int)TEXTURE_ASSET_ID::NORMAL_SIGN + (int)room_type),
 		 EFFECT_ASSET_ID::TEXTURED,
-		 GEOMETRY_BUFFER_ID::SPRITE });
+		 GEOMETRY_BUFFER_ID::SPRITE,
+		 RENDER_LAYER::ROOM_SIGNIFIER });
 
 	registry.roomSignifiers.emplace(entity);
 	registry.colors.insert(entity, { 1,1,1 });
@@ -2246,8 +2173,7 @@ Entity createObstacle(RenderSystem* renderer, vec2 grid_position) {
 	collidable.size = { motion.scale.x, motion.scale.y };
 	collidable.shift = { 0, 0 };
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
+	std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<> distrib(0, 1);
 	double number = distrib(gen);
 
@@ -2629,27 +2555,11 @@ Entity createTile(RenderSystem* renderer, VisibilitySystem* visibility_system, v
 		t.mat
 	};
 
-	// Add visibility tile
-	// We do it here bcause we have already calculated the transform matrix
-	/*
-	This entity has:
-
-	TEXTURE_ASSET_ID::TEXTURE_COUNT,
-	EFFECT_ASSET_ID::EGG,
-	GEOMETRY_BUFFER_ID::DEBUG_LINE2
-	*/
-
-	// Return early here to exclude adding visibility tiles
+	// Return early here to exclude covering tiles with fog
 	if (visibility_info.excluded.find(map_info.level) != visibility_info.excluded.end()) return entity;
 
-	auto entity2 = Entity();
-	registry.visibilityTileInstanceData.emplace(entity2) = {
-		t.mat,
-		1.0
-	};
-	// add reference to entity in 2d array
-	// when removing visibility tile entities, we set it's corresponding grid position in reference map to -1
-	visibility_system->reference_map[grid_position.y][grid_position.x] = entity2;
+	// cover the tile with fog, the visibility system clears it when the tile is revealed
+	visibility_system->fog_at(grid_position) = FOG_OPAQUE;
 
 	return entity;
 }
@@ -2889,7 +2799,8 @@ Entity createButton(RenderSystem* renderer, vec2 pos, float scale,
 		entity,
 		{ TEXTURE_ASSET_ID::BUTTON,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 
 	Button& button = registry.buttons.emplace(entity);
 	button.state = menu_state;
@@ -2919,7 +2830,8 @@ Entity createMainMenu(RenderSystem* renderer, vec2 title_pos, float title_scale,
 		entity,
 		{ TEXTURE_ASSET_ID::MENU_BACKGROUND,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.mainMenus.emplace(entity);
 
 	// Main menu title 
@@ -2937,7 +2849,8 @@ Entity createMainMenu(RenderSystem* renderer, vec2 title_pos, float title_scale,
 		entity2,
 		{ TEXTURE_ASSET_ID::MENU_TITLE,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.mainMenus.emplace(entity2);
 
 	// Paper on buttons for visibility
@@ -2955,7 +2868,8 @@ Entity createMainMenu(RenderSystem* renderer, vec2 title_pos, float title_scale,
 		entity3,
 		{ TEXTURE_ASSET_ID::PAUSE_BACKGROUND,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.mainMenus.emplace(entity3);
 
 	return entity;
@@ -2977,7 +2891,8 @@ Entity createPauseMenu(RenderSystem* renderer, vec2 background_pos, float backgr
 		entity,
 		{ TEXTURE_ASSET_ID::PAUSE_BACKGROUND,
 			EFFECT_ASSET_ID::UI,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::MENU });
 	registry.pauseMenus.emplace(entity);
 
 	return entity;
@@ -3001,7 +2916,8 @@ Entity createTeleporter(RenderSystem* renderer, vec2 pos, vec2 scale, vec2 colli
 		entity,
 		{ texture_asset,
 		EFFECT_ASSET_ID::TEXTURED,
-		GEOMETRY_BUFFER_ID::SPRITE });
+		GEOMETRY_BUFFER_ID::SPRITE,
+		RENDER_LAYER::TELEPORTER });
 	Teleporter& t = registry.teleporters.emplace(entity);
 	t.destination = destination;
 	t.teleport_time = teleport_time;
@@ -3025,6 +2941,7 @@ Entity createAura(RenderSystem* renderer, vec2 pos, float scale, Entity entity_t
 	ani.frame_rate_ms = framerate;
 	ani.full_rate_ms = framerate;
 	ani.is_active = true;
+	ani.start_ms = uni_timer.animation_ms;
 	registry.alwaysplayAni.insert(entity, ani);
 
 	registry.auras.emplace(entity);
@@ -3035,7 +2952,8 @@ Entity createAura(RenderSystem* renderer, vec2 pos, float scale, Entity entity_t
 		entity,
 		{ texture_asset,
 		EFFECT_ASSET_ID::TEXTURED,
-		GEOMETRY_BUFFER_ID::SPRITE });
+		GEOMETRY_BUFFER_ID::SPRITE,
+		RENDER_LAYER::AURA });
 
 	return entity;
 }
@@ -8,6 +8,7 @@
 #include "world_system.hpp"
 #include <random>
 #include "global.hpp"
+#include "particle_system.hpp"
 
 
 // These are ahrd coded to the dimensions of the entity 
@@ -51,7 +52,12 @@ const float ITEM_HEIGHT = 0.5f * 128.f;
 
 // the bullet, takes into account entity's speed and position
 Entity createBullet(RenderSystem* renderer, float entity_speed, vec2 entity_position, float rotation_angle, vec2 direction, float bullet_speed = 100.f, bool is_player_bullet = false, BulletPattern* bullet_pattern = nullptr, bool is_aimbot_bullet = false);
-Entity createBulletDisappear(RenderSystem* renderer, vec2 entity_position, float rotation_angle, bool is_player_bullet);
+// the disappear animation of a player bullet hitting a wall, a particle
+void createBulletDisappear(vec2 entity_position, float rotation_angle);
+// a single dissolve effect for all given enemy bullets
+Entity createBulletDissolve(const std::vector<Entity>& bullets);
+// remove every enemy bullet at once, optionally leaving a batched dissolve effect behind
+void removeEnemyBullets(bool dissolve);
 
 Entity createText(vec2 pos, vec2 scale, std::string text_content, vec3 color, bool is_perm, bool in_world = false);
 
@@ -63,12 +69,13 @@ Entity createCloud(RenderSystem* renderer, vec2 position, float parrallax_value,
 
 void createDialogue(CHARACTER character, std::string sentence, CHARACTER talk_2, EMOTION emotion);
 
-Entity createCriHit(RenderSystem* renderer, vec2 pos);
+// critical hit icon floating up from pos, a particle
+void createCriHit(vec2 pos);
 std::vector<Entity> createAttributeUI(RenderSystem* renderer);
 Entity createHealthUI(RenderSystem*);
 
-// play once vfx that gets destroyed after animation
-Entity createVFX(RenderSystem* renderer, vec2 pos, vec2 scale, float angle, VFX_TYPE type);
+// play once vfx that disappears after its animation, a particle rather than an entity
+void createVFX(vec2 pos, vec2 scale, float angle, VFX_TYPE type);
 
 Entity createHealth(RenderSystem* renderer, vec2 position);
 Entity createPurchasableHealth(RenderSystem* renderer, vec2 position);
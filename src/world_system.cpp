@@ -25,8 +25,6 @@ WorldSystem::WorldSystem()
 	: points(0)
 	, next_enemy_spawn(0.f)
 	, display_instruction(true) {
-	// Seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
 	loadScript("start.txt", start_script);
 	loadScript("cirno.txt", cirno_script);
 	loadScript("cirno_after.txt", cirno_after_script);
@@ -61,7 +59,7 @@ namespace {
 
 // World initialization
 // Note, this has a lot of OpenGL specific things, could be moved to the renderer
-GLFWwindow* WorldSystem::create_window() {
+GLFWwindow* WorldSystem::create_window(bool is_headless) {
 	///////////////////////////////////////
 	// Initialize GLFW
 	glfwSetErrorCallback(glfw_err_cb);
@@ -82,9 +80,13 @@ GLFWwindow* WorldSystem::create_window() {
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 	glfwWindowHint(GLFW_RESIZABLE, 0);
+	if (is_headless) {
+		// the context still needs a display (e.g. Xvfb), the window just stays hidden
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 
 	// Create the main window (for rendering, keyboard, and mouse input)
-	if (option.fullscreen) {
+	if (option.fullscreen && !is_headless) {
 		window = glfwCreateWindow(window_width_px, window_height_px, "Touhou: Twilight Dungeons", glfwGetPrimaryMonitor(), nullptr);
 	}
 	else {
@@ -168,8 +170,7 @@ void WorldSystem::init_menu() {
 		offset_y += offset_y_delta;
 	}
 	createButton(renderer, { offset_x, offset_y }, button_scale, MENU_STATE::MAIN_MENU, "New Game", 0.9f, [&]() {
-		map_info.level = MAP_LEVEL::LEVEL1;
-		restart_game();
+		new_game();
 		});
 	offset_y += offset_y_delta;
 	createButton(renderer, { offset_x, offset_y }, button_scale, MENU_STATE::MAIN_MENU, "Tutorial", 0.9f, [&]() {
@@ -268,6 +269,33 @@ void WorldSystem::init_lose_menu() {
 		});
 }
 
+void WorldSystem::new_game() {
+	map_info.level = MAP_LEVEL::LEVEL1;
+	restart_game();
+}
+
+void WorldSystem::new_scripted_game() {
+	new_game();
+	// past the end of the script, dialogue_step neither shows it nor resumes the game once it ends
+	start_pt = start_script.size() + 1;
+}
+
+const int SCRIPTED_SIDE_FRAMES = 120;
+
+void WorldSystem::scripted_input(int frame) {
+	const int walk_keys[] = { GLFW_KEY_D, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_W };
+	if (frame == 0) {
+		on_mouse_key(GLFW_MOUSE_BUTTON_LEFT, GLFW_PRESS, 0);
+	}
+	if (frame % SCRIPTED_SIDE_FRAMES == 0) {
+		int side = frame / SCRIPTED_SIDE_FRAMES % 4;
+		if (frame > 0) {
+			on_key(walk_keys[(side + 3) % 4], 0, GLFW_RELEASE, 0);
+		}
+		on_key(walk_keys[side], 0, GLFW_PRESS, 0);
+	}
+}
+
 void WorldSystem::resume_game() {
 	////Mix_ResumeMusic();
 	menu.state = MENU_STATE::PLAY;
@@ -283,6 +311,52 @@ void WorldSystem::resume_game() {
 	pressed[GLFW_KEY_LEFT_SHIFT] = false;
 }
 
+// The HUD texts are permanent, they are removed with everything else that has a motion on restart
+void WorldSystem::create_hud_texts() {
+	hud_texts.clear();
+	const vec2 hud_text_positions[] = { { 260, 70 }, { 68, 153 }, { 72, 200 }, { 86, 250 }, { 86, 300 }, { 103, 350 }, { 68, 400 } };
+	for (const vec2& position : hud_text_positions) {
+		Entity text = createText(-window_px_half + position, { 1,1 }, "", vec3(1), true);
+		registry.textsPerm.get(text).is_hud = true;
+		hud_texts.push_back(text);
+	}
+	update_hud_texts();
+}
+
+// Only the content changes, the renderer reuses the cached layout while it stays the same
+void WorldSystem::update_hud_texts() {
+	HP& player_hp = registry.hps.get(player);
+	Player& player_att = registry.players.get(player);
+	std::string fire_rate = std::to_string(player_att.fire_rate);
+	std::string critical_hit = std::to_string(player_att.critical_hit * 100);
+	std::string critical_dmg = std::to_string(player_att.critical_damage * 100);
+	const std::string contents[] = {
+		std::to_string(player_hp.curr_hp) + " / " + std::to_string(player_hp.max_hp),
+		std::to_string(player_att.coin_amount),
+		std::to_string(player_att.bullet_damage),
+		fire_rate.substr(0, fire_rate.find(".") + 3),
+		critical_hit.substr(0, critical_hit.find(".") + 3),
+		critical_dmg.substr(0, critical_dmg.find(".") + 3),
+		std::to_string(player_att.bomb),
+	};
+	for (size_t i = 0; i < hud_texts.size(); ++i) {
+		std::string& content = registry.textsPerm.get(hud_texts[i]).content;
+		if (content != contents[i]) content = contents[i];
+	}
+}
+
+// Sets uni_timer.animation_ms back to 0 so the float clock keeps millisecond precision
+// Entities surviving the restart keep their frame, their start_ms moves with the clock
+void WorldSystem::restart_animation_clock() {
+	const float clock_ms = uni_timer.animation_ms;
+	for (ComponentContainer<EntityAnimation>* container : { &registry.animation, &registry.alwaysplayAni, &registry.playonceAni }) {
+		for (EntityAnimation& animation : container->components) {
+			animation.start_ms -= clock_ms;
+		}
+	}
+	uni_timer.animation_ms = 0;
+}
+
 // Update our game world
 bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	tutorial_counter--;
@@ -323,20 +397,8 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 		registry.renderRequests.get(display_combo).used_texture = TEXTURE_ASSET_ID::S;
 	}
 
-	// Create on screen player attributes ui
-	HP& player_hp = registry.hps.get(player);
-	//createText({ 128 * 1.3 + 70 - 4, window_height_px - 77 }, { 1,1 }, std::to_string(player_hp.curr_hp) + " / " + std::to_string(player_hp.max_hp), vec3(1, 1, 1), false);
-	createText(-window_px_half + vec2(260, 70), { 1,1 }, std::to_string(player_hp.curr_hp) + " / " + std::to_string(player_hp.max_hp), vec3(1, 1, 1), false);
-	Player& player_att = registry.players.get(player);
-	std::string fire_rate = std::to_string(player_att.fire_rate);
-	std::string critical_hit = std::to_string(player_att.critical_hit * 100);
-	std::string critical_dmg = std::to_string(player_att.critical_damage * 100);
-	createText(-window_px_half + vec2(68, 153), { 1,1 }, std::to_string(player_att.coin_amount), vec3(1), false);
-	createText(-window_px_half + vec2(72, 200), { 1,1 }, std::to_string(player_att.bullet_damage), vec3(1), false);
-	createText(-window_px_half + vec2(86, 250), { 1,1 }, fire_rate.substr(0, fire_rate.find(".") + 3), vec3(1), false);
-	createText(-window_px_half + vec2(86, 300), { 1,1 }, critical_hit.substr(0, critical_hit.find(".") + 3), vec3(1), false);
-	createText(-window_px_half + vec2(103, 350), { 1,1 }, critical_dmg.substr(0, critical_dmg.find(".") + 3), vec3(1), false);
-	createText(-window_px_half + vec2(68, 400), { 1,1 }, std::to_string(player_att.bomb), vec3(1), false);
+	// Update on screen player attributes ui
+	update_hud_texts();
 
 	// Interpolate camera to smoothly follow player based on sharpness factor - elapsed time for independent of fps
 	// sharpness_factor_camera = 0 (not following) -> 0.5 (delay) -> 1 (always following)
@@ -399,43 +461,29 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 		}
 	}
 
-	// Get closest enemy
+	// Rebuild lock on grid of enemies, once per frame
+	// Do not allow lock on if boss is not active
+	bool can_lock_on_boss = (map_info.level == MAP_LEVEL::LEVEL1 && boss_info.has_cirno_talked) ||
+		(map_info.level == MAP_LEVEL::LEVEL2 && boss_info.has_flandre_talked) ||
+		(map_info.level == MAP_LEVEL::LEVEL3 && boss_info.has_sakuya_talked) ||
+		(map_info.level == MAP_LEVEL::LEVEL4 && boss_info.has_remilia_talked);
+	enemy_grid.clear();
+	for (Entity entity : registry.deadlys.entities) {
+		if (!can_lock_on_boss && registry.bosses.has(entity)) continue;
+		enemy_grid.insert(entity, registry.motions.get(entity).position);
+	}
+	enemy_grid.build(2.f * world_tile_size);
+
+	// Get enemy closest to cursor
 	Player& player_c = registry.players.components[0];
 	if (player_c.ammo_type == AMMO_TYPE::AIMBOT ||
 		player_c.ammo_type == AMMO_TYPE::AIMBOT1BULLET) {
-		uni_timer.closest_enemy_timer -= uni_timer.closest_enemy_timer >= 0 ? elapsed_ms_since_last_update : 0;
 		uni_timer.aimbot_bullet_timer -= uni_timer.aimbot_bullet_timer >= 0 ? elapsed_ms_since_last_update : 0;
-		if (uni_timer.closest_enemy_timer < 0) {
-			double mouse_pos_x;
-			double mouse_pos_y;
-			glfwGetCursorPos(window, &mouse_pos_x, &mouse_pos_y);
-			vec2 mouse_position_world = vec2(mouse_pos_x, mouse_pos_y) - window_px_half + player_position;
-			float maximum_range = 20 * world_tile_size * 20 * world_tile_size;
-			int closest_entity_id = -1;
-			float closest_distance = std::numeric_limits<float>::max();
-			for (Entity entity : registry.deadlys.entities) {
-				Motion& motion = registry.motions.get(entity);
-				vec2 dp = motion.position - mouse_position_world;
-				float dot_dp = dot(dp, dp);
-				if (dot_dp < maximum_range && dot_dp < closest_distance) {
-					closest_distance = dot_dp;
-					closest_entity_id = entity;
-				}
-			}
-			// Do not allow lock on if boss is not active
-			Entity entity_copy = (Entity)closest_entity_id;
-			if (registry.bosses.has(entity_copy)) {
-				if ((map_info.level == MAP_LEVEL::LEVEL1 && boss_info.has_cirno_talked) ||
-					(map_info.level == MAP_LEVEL::LEVEL2 && boss_info.has_flandre_talked) ||
-					(map_info.level == MAP_LEVEL::LEVEL3 && boss_info.has_sakuya_talked) ||
-					(map_info.level == MAP_LEVEL::LEVEL4 && boss_info.has_remilia_talked))
-					uni_timer.closest_enemy = closest_entity_id;
-			}
-			else {
-				uni_timer.closest_enemy = closest_entity_id;
-			}
-			uni_timer.closest_enemy_timer = uni_timer.closest_enemy_timer_default;
-		}
+		double mouse_pos_x;
+		double mouse_pos_y;
+		glfwGetCursorPos(window, &mouse_pos_x, &mouse_pos_y);
+		vec2 mouse_position_world = vec2(mouse_pos_x, mouse_pos_y) - window_px_half + player_position;
+		uni_timer.closest_enemy = enemy_grid.nearest(mouse_position_world, LOCK_ON_RANGE_TILES * world_tile_size);
 	}
 
 	// Processing the player state
@@ -532,8 +580,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 				return true;
 			}
 			else if (registry.deadlys.has(entity)) {
-				std::random_device rd;
-				std::mt19937 gen(rd());
+				std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 				std::uniform_real_distribution<> distrib(0, 1);
 				double number = distrib(gen) * combo_mode.combo_meter / 2;
 				int coin_number = 1;
@@ -647,8 +694,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 					}
 
 					// remove all bullets when boss hp < 0
-					while (registry.enemyBullets.entities.size() > 0)
-						registry.remove_all_components_of(registry.enemyBullets.entities.back());
+					removeEnemyBullets(true);
 				}
 
 				// remove auras
@@ -780,10 +826,7 @@ void WorldSystem::next_level() {
 		}
 		registry.remove_all_components_of(registry.motions.entities.back());
 	}
-
-	// Since visibility tile do not have motion, iterate and remove here
-	while (registry.visibilityTileInstanceData.entities.size() > 0)
-		registry.remove_all_components_of(registry.visibilityTileInstanceData.entities.back());
+	particles.clear();
 
 	// initialize menus
 	init_menu();
@@ -842,9 +885,11 @@ void WorldSystem::next_level() {
 	focus_mode.restart();
 	ai->restart_flow_field_map();
 	display_combo = createCombo(renderer);
+	create_hud_texts();
 	game_info.set_player_id(player);
 	boss_info.reset();
 	uni_timer.restart();
+	restart_animation_clock();
 	init_win_menu();
 	init_lose_menu();
 	renderer->camera.setPosition({ 0, 0 });
@@ -911,10 +956,7 @@ void WorldSystem::restart_game() {
 	// All that have a motion, we could also iterate over all enemies, coins, ... but that would be more cumbersome
 	while (registry.motions.entities.size() > 0)
 		registry.remove_all_components_of(registry.motions.entities.back());
-
-	// Since visibility tile do not have motion, iterate and remove here
-	while (registry.visibilityTileInstanceData.entities.size() > 0)
-		registry.remove_all_components_of(registry.visibilityTileInstanceData.entities.back());
+	particles.clear();
 
 	// initialize menus
 	init_menu();
@@ -970,9 +1012,11 @@ void WorldSystem::restart_game() {
 	focus_mode.restart();
 	ai->restart_flow_field_map();
 	display_combo = createCombo(renderer);
+	create_hud_texts();
 	game_info.set_player_id(player);
 	boss_info.reset();
 	uni_timer.restart();
+	restart_animation_clock();
 	stats.reset();
 	bomb_timer = 0;
 	init_win_menu();
@@ -1276,6 +1320,7 @@ void WorldSystem::handle_collisions() {
 					player_kin.speed_modified = 0;
 					player_kin.velocity = { 0,0 };
 					ani.is_active = true;
+					ani.start_ms = uni_timer.animation_ms;
 					teleporter.is_teleporting = true;
 				}
 			}
@@ -1291,7 +1336,7 @@ void WorldSystem::handle_collisions() {
 						float scale = 3.f;
 						float radius_squared = ENEMY_BB_WIDTH_100 * scale / 2.f * ENEMY_BB_WIDTH_100 * scale / 2.f;
 						Motion& deadly_motion_hit = registry.motions.get(entity);
-						createVFX(renderer, deadly_motion_hit.position, scale * vec2(ENEMY_BB_WIDTH_100, ENEMY_BB_HEIGHT_100), 0, VFX_TYPE::AOE_AMMO_EXPLOSION);
+						createVFX(deadly_motion_hit.position, scale * vec2(ENEMY_BB_WIDTH_100, ENEMY_BB_HEIGHT_100), 0, VFX_TYPE::AOE_AMMO_EXPLOSION);
 						for (Entity deadly_entity : registry.deadlys.entities) {
 							if (registry.hitTimers.has(deadly_entity) || registry.realDeathTimers.has(deadly_entity)) continue;
 							Motion& deadly_motion = registry.motions.get(deadly_entity);
@@ -1302,13 +1347,12 @@ void WorldSystem::handle_collisions() {
 							registry.hitTimers.emplace(deadly_entity);
 							registry.colors.get(deadly_entity) = vec3(-1.f);
 
-							std::random_device rd;
-							std::mt19937 gen(rd());
+							std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 							std::uniform_real_distribution<> distrib(0, 1);
 							double number = distrib(gen);
 							if (number < player_att.critical_hit) {
 								registry.hps.get(deadly_entity).curr_hp -= registry.playerBullets.get(entity_other).damage * player_att.critical_damage * 1.5f;
-								registry.realDeathTimers.emplace(createCriHit(renderer, deadly_motion.position - vec2(30, 0))).death_counter_ms = 300;
+								createCriHit(deadly_motion.position - vec2(30, 0));
 							}
 							else {
 								registry.hps.get(deadly_entity).curr_hp -= registry.playerBullets.get(entity_other).damage;
@@ -1365,16 +1409,15 @@ void WorldSystem::handle_collisions() {
 							Motion& bullet_motion = registry.motions.get(entity_other);
 							// assume deadly and bullet collidable boxes are centered in the texture
 							vec2 center_delta = bullet_motion.position - deadly_motion.position;
-							createVFX(renderer, deadly_motion.position, 2.5f * vec2(ENEMY_BB_WIDTH_48, ENEMY_BB_HEIGHT_48), -atan2(center_delta.x, center_delta.y) - glm::radians(90.0f), VFX_TYPE::HIT_SPARK);
+							createVFX(deadly_motion.position, 2.5f * vec2(ENEMY_BB_WIDTH_48, ENEMY_BB_HEIGHT_48), -atan2(center_delta.x, center_delta.y) - glm::radians(90.0f), VFX_TYPE::HIT_SPARK);
 						}
 
-						std::random_device rd;
-						std::mt19937 gen(rd());
+						std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 						std::uniform_real_distribution<> distrib(0, 1);
 						double number = distrib(gen);
 						if (number < player_att.critical_hit) {
 							registry.hps.get(entity).curr_hp -= registry.playerBullets.get(entity_other).damage * player_att.critical_damage;
-							registry.realDeathTimers.emplace(createCriHit(renderer, deadly_motion.position - vec2(30, 0))).death_counter_ms = 300;
+							createCriHit(deadly_motion.position - vec2(30, 0));
 						}
 						else {
 							registry.hps.get(entity).curr_hp -= registry.playerBullets.get(entity_other).damage;
@@ -1437,8 +1480,7 @@ void WorldSystem::handle_collisions() {
 
 				// Handle case when both entities are perfectly on top of each other
 				if (length(center_delta) < 0.001) {
-					std::random_device ran;
-					std::mt19937 gen(ran());
+					std::mt19937& gen = rng_service.get(RNG_STREAM::WORLD);
 					std::uniform_real_distribution<> dis(0, 1);
 					float x_sign = dis(gen) < 0.5 ? 1 : -1;
 					float y_sign = dis(gen) < 0.5 ? 1 : -1;
@@ -1707,9 +1749,7 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 			if (player_component.bomb > 0) {
 				player_component.bomb -= 1;
 				bomb_timer = bomb_timer_max;
-				for (Entity bullets : registry.enemyBullets.entities) {
-					registry.remove_all_components_of(bullets);
-				}
+				removeEnemyBullets(true);
 
 				// deal damage
 				// in tutorial
@@ -21,6 +21,7 @@
 #include <map>
 #include "visibility_system.hpp"
 #include "boss_system.hpp"
+#include "spatial_grid.hpp"
 #include <chrono>
 using Clock = std::chrono::high_resolution_clock;
 
@@ -39,7 +40,17 @@ public:
 	WorldSystem();
 
 	// Creates a window
-	GLFWwindow* create_window();
+	// is_headless hides it, a display is still needed for the GL context (e.g. run under xvfb-run)
+	GLFWwindow* create_window(bool is_headless = false);
+
+	// starts a new game at level 1, as the main menu's "New Game" button
+	void new_game();
+
+	// Scripted scene (see main): new_game without the opening dialogue, which only mouse clicks advance
+	void new_scripted_game();
+	// Input of the scripted scene before frame is stepped: the player fires at the cursor throughout
+	// and walks a square, right, down, left and up for SCRIPTED_SIDE_FRAMES frames each
+	void scripted_input(int frame);
 
 	// starts the game
 	void WorldSystem::init(RenderSystem* renderer_arg, Audio* audio, MapSystem* map, AISystem* ai, VisibilitySystem* visibility_arg, BossSystem* boss_arg);
@@ -156,6 +167,13 @@ private:
 	float tutorial_timer = 10000.0f;
 	Entity display_combo;
 
+	// Player attribute texts of the HUD, created on restart and kept across steps
+	// hp, coins, damage, fire rate, critical hit, critical damage, bombs
+	std::vector<Entity> hud_texts;
+	void create_hud_texts();
+	void update_hud_texts();
+	void restart_animation_clock();
+
 	// fonts seting
 	//std::string font_filename = "..//..//..//data//fonts//pixelmix//pixelmix.ttf";
 	std::string font_filename = font_path("pixelmix/pixelmix.ttf").c_str();
@@ -168,8 +186,8 @@ private:
 	// World Map
 	MapSystem* map;
 
-	// C++ random number generator
-	std::default_random_engine rng;
+	// C++ random number generator, drawn from the seedable WORLD substream
+	std::mt19937& rng = rng_service.get(RNG_STREAM::WORLD);
 	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 
 	// fonts